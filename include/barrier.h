@@ -38,7 +38,8 @@
 #  include <sys/procset.h>
 #endif /* __sparc */
 
-#define NUM_BARRIERS 16
+#define NUM_BARRIERS 16		/* per group of processes */
+#define BARRIER_GROUP(g) ((g) * NUM_BARRIERS)
 #define BARRIER_MEM_FILE "/barrier_mem"
 
 #ifndef ALIGNED
@@ -60,7 +61,8 @@ typedef ALIGNED(64) struct barrier
 } barrier_t;
 
 
-void barriers_init(const uint32_t num_procs);
+void barriers_init(const uint32_t num_procs, const uint32_t num_groups, const int private_mem);
+void barriers_resize(const uint32_t base, const uint32_t num_procs);
 void barrier_init(const uint32_t barrier_num, const uint64_t participants, int (*color)(int), const uint32_t);
 void barrier_wait(const uint32_t barrier_num, const uint32_t id, const uint32_t total_cores);
 void barriers_term();
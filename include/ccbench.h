@@ -49,6 +49,11 @@
 #include <assert.h>
 #include <float.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dlfcn.h>
 
 #if defined(__amd64__)
 #  include <emmintrin.h>
@@ -66,11 +71,10 @@ extern cpu_set_t cpus;
 #include "common.h"
 #include "pfd.h"
 #include "barrier.h"
-
-typedef struct cache_line
-{
-  volatile uint32_t word[16];
-} cache_line_t;
+#include "topology.h"
+#include "cpu.h"
+#include "ccbench_plugin.h"
+#include "kernels.h"
 
 #define CACHE_LINE_NUM      1024*1024 /* power of 2 pls */
 #define CACHE_LINE_STRIDE_2 2047
@@ -116,9 +120,17 @@ typedef enum
     PROFILER,
     PAUSE,
     NOP,
+    PING_PONG,
     NUM_EVENTS,			/* placeholder for printing the num of events */
   } moesi_type_t;
 
+const char* access_pattern_des[] =
+  {
+    "none",
+    "random",
+    "shuffle",
+  };
+
 const char* moesi_type_des[] =
   {
     "STORE_ON_MODIFIED",
@@ -155,8 +167,560 @@ const char* moesi_type_des[] =
     "PROFILER",
     "PAUSE",
     "NOP",
+    "PING_PONG",
+  };
+
+/* which core (ID) and which pfd store hold the measurement that characterizes each event. */
+/* Used when a single number per run is needed (e.g., the --matrix mode) */
+typedef struct moesi_target
+{
+  uint8_t id;
+  uint8_t store;
+} moesi_target_t;
+
+const moesi_target_t moesi_target[] =
+  {
+    { 1, 0 },			/* STORE_ON_MODIFIED */
+    { 1, 0 },			/* STORE_ON_MODIFIED_NO_SYNC */
+    { 1, 0 },			/* STORE_ON_EXCLUSIVE */
+    { 1, 0 },			/* STORE_ON_SHARED */
+    { 1, 1 },			/* STORE_ON_OWNED_MINE */
+    { 1, 1 },			/* STORE_ON_OWNED */
+    { 0, 0 },			/* STORE_ON_INVALID */
+    { 1, 0 },			/* LOAD_FROM_MODIFIED */
+    { 1, 0 },			/* LOAD_FROM_EXCLUSIVE */
+    { 2, 0 },			/* LOAD_FROM_SHARED */
+    { 2, 0 },			/* LOAD_FROM_OWNED */
+    { 0, 0 },			/* LOAD_FROM_INVALID */
+    { 1, 0 },			/* CAS */
+    { 1, 0 },			/* FAI */
+    { 1, 0 },			/* TAS */
+    { 1, 0 },			/* SWAP */
+    { 1, 0 },			/* CAS_ON_MODIFIED */
+    { 1, 0 },			/* FAI_ON_MODIFIED */
+    { 1, 0 },			/* TAS_ON_MODIFIED */
+    { 1, 0 },			/* SWAP_ON_MODIFIED */
+    { 1, 0 },			/* CAS_ON_SHARED */
+    { 1, 0 },			/* FAI_ON_SHARED */
+    { 1, 0 },			/* TAS_ON_SHARED */
+    { 1, 0 },			/* SWAP_ON_SHARED */
+    { 1, 0 },			/* CAS_CONCURRENT */
+    { 0, 0 },			/* FAI_ON_INVALID */
+    { 0, 0 },			/* LOAD_FROM_L1 */
+    { 0, 0 },			/* LOAD_FROM_MEM_SIZE */
+    { 0, 0 },			/* LFENCE */
+    { 0, 0 },			/* SFENCE */
+    { 0, 0 },			/* MFENCE */
+    { 0, 0 },			/* PROFILER */
+    { 0, 0 },			/* PAUSE */
+    { 0, 0 },			/* NOP */
+    { 0, 0 },			/* PING_PONG */
+  };
+
+/* the three-party events: which ID brings the line first (owner), which one gets a second */
+/* copy (sharer), and which one performs the target operation (requester) */
+typedef struct three_party
+{
+  moesi_type_t event;
+  uint8_t owner;
+  uint8_t sharer;
+  uint8_t requester;
+} three_party_t;
+
+const three_party_t three_party[] =
+  {
+    { STORE_ON_SHARED,  0, 2, 1 },
+    { LOAD_FROM_SHARED, 0, 1, 2 },
+    { LOAD_FROM_OWNED,  0, 1, 2 },
+    { CAS_ON_SHARED,    0, 2, 1 },
+    { FAI_ON_SHARED,    0, 2, 1 },
+    { TAS_ON_SHARED,    0, 2, 1 },
+    { SWAP_ON_SHARED,   0, 2, 1 },
+  };
+
+#define THREE_PARTY_NUM (sizeof(three_party) / sizeof(three_party[0]))
+
+/* the kernels that the steps of a scenario run (see run_test) */
+typedef enum
+  {
+    K_NONE,
+    K_STORE,			/* store_0_eventually */
+    K_STORE_ONE,		/* store_0 */
+    K_STORE_NO_PF,		/* store_0_no_pf */
+    K_LOAD,			/* load_0_eventually */
+    K_LOAD_ONE,			/* load_0 */
+    K_LOAD_NO_PF,		/* load_0_eventually_no_pf */
+    K_CHASE,			/* load_next */
+    K_INVALIDATE,
+    K_CAS,
+    K_CAS_EVENTUALLY,		/* cas_0_eventually */
+    K_CAS_NO_PF,
+    K_FAI,
+    K_TAS,
+    K_SWAP,
+    K_LFENCE,
+    K_SFENCE,
+    K_MFENCE,
+    K_PAUSE,
+    K_NOP,
+    K_EMPTY,			/* an empty profiler region */
+    K_PING,
+    K_PONG,
+    K_CAS_ARM,			/* untimed: the value that makes the next CAS (un)successful */
+    K_TAS_ARM,			/* untimed: the value that makes the next TAS (un)successful */
+    K_TAS_SET,			/* untimed: the value of --success for TAS_ON_SHARED */
+    K_TAS_RELEASE,		/* untimed: clears the lock word after a TAS */
+    K_OP_STORE,			/* the primitives of --scenario, on word 0 of the line */
+    K_OP_LOAD,
+    K_OP_CAS,
+    K_OP_FAI,
+    K_OP_TAS,
+    K_OP_SWAP,
+    K_OP_FLUSH,
+    K_PLUGIN,			/* the measure callback of the event of a plugin */
+  } kernel_t;
+
+#define SCEN_PHASES  8		/* separated by BP(0), BP(1), ... */
+#define SCEN_STEPS   16
+#define SCEN_DES     4
+#define SCEN_OTHERS  0xFF	/* the role of every ID that has no steps of its own */
+#define SCEN_UNTIMED 0xFF	/* the slot of the steps of --scenario that are not timed */
+#define SCEN_NAME    32
+
+/* in phase, the role (ID) runs kernel, which measures into the pfd store slot */
+typedef struct scen_step
+{
+  uint8_t role;
+  uint8_t phase;
+  uint8_t kernel;
+  uint8_t slot;
+} scen_step_t;
+
+/* when a line of the description of the results is printed */
+typedef enum
+  {
+    DES_ALWAYS,
+    DES_FLUSH,
+    DES_NO_FLUSH,
+    DES_CORES_LT3,
+    DES_CORES_GE3,
+    DES_CORES_EQ3,
+    DES_CORES_NE3,
+  } des_cond_t;
+
+/* the value that the format of a description line prints, if any */
+typedef enum
+  {
+    DES_ARG_NONE,
+    DES_ARG_CAS_SUCCESS,	/* % of successful CAS */
+    DES_ARG_TAS_SUCCESS,	/* % of successful TAS */
+    DES_ARG_ROUNDS,		/* PING_PONG_ROUNDS */
+    DES_ARG_MEM_KIB,		/* test_mem_size in KiB */
+  } des_arg_t;
+
+typedef struct scen_des
+{
+  uint8_t cond;
+  uint8_t arg;
+  const char* text;
+} scen_des_t;
+
+/* an event as data: the steps of every role in every phase of a repetition. All the IDs */
+/* cross the barriers between the phases, but only run the steps of their role */
+typedef struct scenario
+{
+  uint8_t phases;
+  uint8_t advance;		/* a fresh cache line, test_stride further, on every repetition */
+  scen_step_t step[SCEN_STEPS];	/* terminated by K_NONE */
+  scen_des_t des[SCEN_DES];	/* terminated by a NULL text */
+} scenario_t;
+
+/* the steps of one ID in every phase of a scenario (see scenario_plan) */
+typedef struct scen_plan
+{
+  uint32_t num[SCEN_PHASES];
+  scen_step_t step[SCEN_PHASES][SCEN_STEPS];
+  uint32_t slots;		/* the pfd stores that the ID measures into, a bit per store */
+} scen_plan_t;
+
+#define SO SCEN_OTHERS
+
+const scenario_t scenarios[] =
+  {
+    {				/* STORE_ON_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_STORE, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : store on invalid" },
+	{ DES_FLUSH, DES_ARG_NONE, "Results from Core 1 : store on modified" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 and 1 : store on modified" } },
+    },
+    {				/* STORE_ON_MODIFIED_NO_SYNC */
+      1, 0,
+      { { 0, 0, K_STORE_ONE, 0 }, { 1, 0, K_STORE_ONE, 0 }, { 2, 0, K_STORE_ONE, 0 },
+	{ SO, 0, K_STORE_NO_PF, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results do not make sense" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 and 1 : store on modified while another core is "
+	  "also trying to do the same" } },
+    },
+    {				/* STORE_ON_EXCLUSIVE */
+      2, 1,
+      { { 0, 0, K_LOAD, 0 }, { 1, 1, K_STORE, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid, BUT could have prefetching" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : store on exclusive" } },
+    },
+    {				/* STORE_ON_SHARED */
+      3, 0,
+      { { 0, 0, K_LOAD, 0 }, { 1, 2, K_STORE, 0 }, { 2, 1, K_LOAD, 0 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 & 2: load from modified and exclusive or shared, "
+	  "respectively" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : store on shared" },
+	{ DES_CORES_LT3, DES_ARG_NONE, "Need >=3 processes to achieve STORE_ON_SHARED" } },
+    },
+    {				/* STORE_ON_OWNED_MINE */
+      3, 0,
+      { { 0, 1, K_LOAD, 0 }, { 1, 0, K_STORE, 0 }, { 1, 2, K_STORE, 1 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from modified (makes it owned, if owned "
+	  "state is supported)" },
+	{ DES_FLUSH, DES_ARG_NONE, "Results 1 from Core 1 : store to invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results 1 from Core 1 : store to modified mine" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results 2 from Core 1 : store to owned mine (if owned is supported, "
+	  "else exclusive)" } },
+    },
+    {				/* STORE_ON_OWNED */
+      3, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_LOAD, 0 }, { 1, 2, K_STORE, 1 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to modified" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to invalid" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results 1 from Core 1 : load from modified (makes it owned, if owned "
+	  "state is supported)" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results 2 from Core 1 : store to owned (if owned is supported, else "
+	  "exclusive mine)" } },
+    },
+    {				/* STORE_ON_INVALID */
+      2, 1,
+      { { 0, 1, K_STORE_ONE, 0 }, { 1, 0, K_INVALIDATE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : store on invalid" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : cache line flush" } },
+    },
+    {				/* LOAD_FROM_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_LOAD, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to owned mine (if owned state supported, "
+	  "else exclusive)" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : load from modified (makes it owned, if owned "
+	  "state supported)" } },
+    },
+    {				/* LOAD_FROM_EXCLUSIVE */
+      2, 1,
+      { { 0, 0, K_LOAD, 0 }, { 1, 1, K_LOAD, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid, BUT could have prefetching" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : load from exclusive" } },
+    },
+    {				/* LOAD_FROM_SHARED */
+      3, 1,
+      { { 0, 0, K_LOAD, 0 }, { 1, 1, K_LOAD, 0 }, { 2, 2, K_LOAD, 0 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : load from invalid, BUT could have prefetching" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : load from exclusive" },
+	{ DES_CORES_GE3, DES_ARG_NONE, "Results from Core 2 : load from shared" } },
+    },
+    {				/* LOAD_FROM_OWNED */
+      3, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_LOAD, 0 }, { 2, 2, K_LOAD, 0 } },
+      { { DES_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to invalid" },
+	{ DES_NO_FLUSH, DES_ARG_NONE, "Results from Core 0 : store to owned mine (if owned is supported, "
+	  "else shared)" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : load from modified" },
+	{ DES_CORES_EQ3, DES_ARG_NONE, "Results from Core 2 : load from owned" } },
+    },
+    {				/* LOAD_FROM_INVALID */
+      2, 1,
+      { { 0, 1, K_LOAD, 0 }, { 1, 0, K_INVALIDATE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from invalid" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : cache line flush" } },
+    },
+    {				/* CAS */
+      2, 0,
+      { { 0, 0, K_CAS_EVENTUALLY, 0 }, { 1, 1, K_CAS_EVENTUALLY, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : CAS successfull" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : CAS unsuccessfull" } },
+    },
+    {				/* FAI */
+      2, 0,
+      { { 0, 0, K_FAI, 0 }, { 1, 1, K_FAI, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: FAI" } },
+    },
+    {				/* TAS */
+      3, 0,
+      { { 0, 0, K_TAS, 0 }, { 1, 1, K_TAS, 0 }, { 1, 1, K_TAS_RELEASE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : TAS successfull" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : TAS unsuccessfull" } },
+    },
+    {				/* SWAP */
+      2, 0,
+      { { 0, 0, K_SWAP, 0 }, { 1, 1, K_SWAP, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: SWAP" } },
+    },
+    {				/* CAS_ON_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 0, 0, K_CAS_ARM, 0 }, { 1, 1, K_CAS_EVENTUALLY, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : store on modified" },
+	{ DES_ALWAYS, DES_ARG_CAS_SUCCESS, "Results from Core 1 : CAS on modified (%u%% successfull)" } },
+    },
+    {				/* FAI_ON_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_FAI, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : store on modified" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : FAI on modified" } },
+    },
+    {				/* TAS_ON_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 0, 0, K_TAS_ARM, 0 }, { 1, 1, K_TAS, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : store on modified" },
+	{ DES_ALWAYS, DES_ARG_TAS_SUCCESS, "Results from Core 1 : TAS on modified (%u%% successfull)" } },
+    },
+    {				/* SWAP_ON_MODIFIED */
+      2, 0,
+      { { 0, 0, K_STORE, 0 }, { 1, 1, K_SWAP, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : store on modified" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : SWAP on modified" } },
+    },
+    {				/* CAS_ON_SHARED */
+      3, 0,
+      { { 0, 0, K_LOAD, 0 }, { 1, 2, K_CAS_EVENTUALLY, 0 }, { 2, 1, K_LOAD, 0 }, 
+	{ SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from modified" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : CAS on shared (100%% successfull)" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 2 : load from exlusive or shared" },
+	{ DES_CORES_LT3, DES_ARG_NONE, "Need >=3 processes to achieve CAS_ON_SHARED" } },
+    },
+    {				/* FAI_ON_SHARED */
+      3, 0,
+      { { 0, 0, K_LOAD, 0 }, { 1, 2, K_FAI, 0 }, { 2, 1, K_LOAD, 0 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from modified" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : FAI on shared" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 2 : load from exlusive or shared" },
+	{ DES_CORES_LT3, DES_ARG_NONE, "Need >=3 processes to achieve FAI_ON_SHARED" } },
+    },
+    {				/* TAS_ON_SHARED */
+      3, 0,
+      { { 0, 0, K_TAS_SET, 0 }, { 0, 0, K_LOAD, 0 }, { 1, 2, K_TAS, 0 }, { 2, 1, K_LOAD, 0 },
+	{ SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from L1" },
+	{ DES_ALWAYS, DES_ARG_TAS_SUCCESS, "Results from Core 1 : TAS on shared (%u%% successfull)" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 2 : load from exlusive or shared" },
+	{ DES_CORES_LT3, DES_ARG_NONE, "Need >=3 processes to achieve TAS_ON_SHARED" } },
+    },
+    {				/* SWAP_ON_SHARED */
+      3, 0,
+      { { 0, 0, K_LOAD, 0 }, { 1, 2, K_SWAP, 0 }, { 2, 1, K_LOAD, 0 }, { SO, 1, K_LOAD_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : load from modified" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : SWAP on shared" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 2 : load from exlusive or shared" },
+	{ DES_CORES_LT3, DES_ARG_NONE, "Need >=3 processes to achieve SWAP_ON_SHARED" } },
+    },
+    {				/* CAS_CONCURRENT */
+      1, 0,
+      { { 0, 0, K_CAS, 0 }, { 1, 0, K_CAS, 0 }, { SO, 0, K_CAS_NO_PF, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: CAS concurrent" } },
+    },
+    {				/* FAI_ON_INVALID */
+      2, 1,
+      { { 0, 1, K_FAI, 0 }, { 1, 0, K_INVALIDATE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0 : FAI on invalid" },
+	{ DES_ALWAYS, DES_ARG_NONE, "Results from Core 1 : cache line flush" } },
+    },
+    {				/* LOAD_FROM_L1 */
+      1, 0,
+      { { 0, 0, K_LOAD_ONE, 0 }, { 0, 0, K_LOAD_ONE, 0 }, { 0, 0, K_LOAD_ONE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Core 0: load from L1" } },
+    },
+    {				/* LOAD_FROM_MEM_SIZE */
+      1, 0,
+      { { 0, 0, K_CHASE, 0 }, { 1, 0, K_CHASE, 0 }, { 2, 0, K_CHASE, 0 } },
+      { { DES_ALWAYS, DES_ARG_MEM_KIB, "Results from Corees 0 & 1 & 2: load from random %u KiB" } },
+    },
+    {				/* LFENCE */
+      1, 0,
+      { { 0, 0, K_LFENCE, 0 }, { 1, 0, K_LFENCE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: load fence" } },
+    },
+    {				/* SFENCE */
+      1, 0,
+      { { 0, 0, K_SFENCE, 0 }, { 1, 0, K_SFENCE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: store fence" } },
+    },
+    {				/* MFENCE */
+      1, 0,
+      { { 0, 0, K_MFENCE, 0 }, { 1, 0, K_MFENCE, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: full fence" } },
+    },
+    {				/* PROFILER */
+      1, 0,
+      { { 0, 0, K_EMPTY, 0 }, { SO, 0, K_EMPTY, 0 } },
+      { { DES_ALWAYS, DES_ARG_NONE, "Results from Cores 0 & 1: empty profiler region (start_prof - empty "
+	  "- stop_prof" } },
+    },
+    {				/* PAUSE */
+      1, 0,
+      { { 0, 0, K_PAUSE, 0 }, { 1, 0, K_PAUSE, 0 } },
+    },
+    {				/* NOP */
+      1, 0,
+      { { 0, 0, K_NOP, 0 }, { 1, 0, K_NOP, 0 } },
+    },
+    {				/* PING_PONG */
+      1, 0,
+      { { 0, 0, K_PING, 0 }, { 1, 0, K_PONG, 0 } },
+      { { DES_ALWAYS, DES_ARG_ROUNDS, "Results from Core 0 : round trip of the line to core 1 (avg of %u)" } },
+    },
   };
 
+#undef SO
+
+/* the primitives of the --scenario language. The fences and the primitives (K_OP_*) time */
+/* into the store of their step, the other kernels always into store 0 (or 1 for K_STORE) */
+typedef struct scen_op
+{
+  const char* name;
+  kernel_t kernel;
+} scen_op_t;
+
+const scen_op_t scen_ops[] =
+  {
+    { "store",   K_OP_STORE },
+    { "load",    K_OP_LOAD },
+    { "cas",     K_OP_CAS },
+    { "fai",     K_OP_FAI },
+    { "tas",     K_OP_TAS },
+    { "swap",    K_OP_SWAP },
+    { "clflush", K_OP_FLUSH },
+    { "lfence",  K_LFENCE },
+    { "sfence",  K_SFENCE },
+    { "mfence",  K_MFENCE },
+    { "pause",   K_PAUSE },
+    { "nop",     K_NOP },
+  };
+
+#define SCEN_OPS_NUM (sizeof(scen_ops) / sizeof(scen_ops[0]))
+
+/* one measurement of a multi-measurement mode (e.g., --matrix): the event, the cores of the */
+/* first three IDs, and the summary of the target measurement of the event */
+#define CELL_CORES 3
+
+typedef struct cell
+{
+  moesi_type_t event;
+  uint32_t core[CELL_CORES];
+  uint32_t procs;		/* the IDs that take part in the cell, 0 = all test_cores */
+  int32_t corunner;		/* the core of the co-runner during the cell, -1 = none */
+  int32_t home;			/* the node of the memory of the cache lines (--home), -1 = any */
+} cell_t;
+
+/* a column of --characterize: a distance class from core1 and, for the remote sockets, the */
+/* node distance (-1 = any) */
+typedef struct char_col
+{
+  topo_class_t cls;
+  int32_t dist;
+  uint32_t core;		/* the representative core */
+  int32_t corunner;		/* the core of the co-runner, -1 = none */
+  char name[32];
+} char_col_t;
+
+#define CHAR_COLS_MAX (TOPO_NUM_CLASSES + 8)
+
+/* a process that keeps the SMT sibling of the measuring core busy during a cell (see --smt). */
+/* It is not a barrier participant: the ID 0 of the group sets core and busy, bumps seq, and */
+/* waits for ack == seq before measuring */
+typedef ALIGNED(64) struct corunner
+{
+  volatile int32_t core;
+  volatile uint32_t busy;
+  volatile uint32_t seq;
+  volatile uint32_t ack;
+  volatile uint32_t stop;
+} corunner_t;
+
+#define CORUNNER_MEM (4 * 1024 * 1024) /* the buffer that the memory co-runner streams over */
+
+/* the rounds of a (concurrent) sweep over cells. In every round, the groups of processes */
+/* measure cells that use disjoint cores */
+typedef struct schedule
+{
+  uint32_t rounds;
+  int32_t* cell;		/* cell[r * test_groups + g]: the cell of group g in round r, or -1 */
+  uint32_t* park;		/* park[r]: the core of the idle processes in round r */
+} schedule_t;
+
+/* where the value of a cell comes from (see --sample) */
+typedef enum
+  {
+    RES_MEASURED,
+    RES_MIRRORED,		/* measured on the swapped pair of a symmetric event */
+    RES_STRATUM,		/* median of the measured cells of the same class and packages */
+    RES_CLASS,			/* median of the measured cells of the same class */
+  } res_source_t;
+
+typedef struct cell_res
+{
+  uint32_t done;
+  uint32_t flagged;		/* concurrent measurement differs from the serial one */
+  res_source_t source;
+  double avg;
+  double median;
+  double std_dev;
+} cell_res_t;
+
+/* the test that rank 0 hands to the other processes with --server and --batch (shared memory) */
+typedef struct request
+{
+  volatile uint32_t seq;	/* bumped by rank 0 for every request to run */
+  volatile uint32_t quit;
+  uint32_t line;			/* of the client or of the --batch file */
+  cell_t cell;
+  uint32_t reps;
+  uint32_t fence;
+  uint32_t stride;
+  size_t mem_size;
+  cell_res_t res;
+} request_t;
+
+/* what main prepares for the roles (processes or threads): read-only, except for the results */
+typedef struct run
+{
+  moesi_type_t test;
+  volatile cache_line_t* cache_line;
+  cell_t* cells;
+  cell_res_t* cells_res;
+  uint32_t cells_num;
+  uint32_t check_num;
+  uint32_t* check_of;
+  schedule_t sched;
+  double resumed_correction;
+  cell_t* matrix;
+  uint32_t matrix_rows;
+  uint32_t* sample_of;
+  char_col_t char_cols[CHAR_COLS_MAX];
+  uint32_t char_cols_num;
+  int32_t* home_nodes;
+  uint32_t sat_pairs[2];
+  request_t* req;		/* --server */
+  int server_fd;
+} run_t;
+
+/* a thread of --threads */
+typedef struct role
+{
+  pthread_t thread;
+  uint32_t rank;
+  const run_t* run;
+  int ret;
+} role_t;
+
 
 #define DEFAULT_CORES       2
 #define DEFAULT_REPS        10000
@@ -173,25 +737,52 @@ const char* moesi_type_des[] =
 #define DEFAULT_LFENCE       0
 #define DEFAULT_SFENCE       0
 #define DEFAULT_AO_SUCCESS  0
+#define DEFAULT_MATRIX      0
+#define DEFAULT_TOPOLOGY    0
+#define DEFAULT_MEM_NODE    -1
+#define DEFAULT_SWEEP3      0
+#define DEFAULT_GROUPS      1
+#define DEFAULT_EPOCH       1
+#define DEFAULT_SAMPLE      0
+#define DEFAULT_CHARACTERIZE 0
+#define DEFAULT_SMT         0
+#define DEFAULT_HOME        0
+#define DEFAULT_DRAM        0
+#define DEFAULT_SATURATE    0
+#define DEFAULT_THREADS     0
+#define PLUGIN_EVENTS_MAX   16
+#define SERVER_LINE         512
+#define SERVER_POLL_US      100	/* how often the idle processes of --server look for a request */
+#define PING_PONG_ROUNDS    64	/* round trips per sample of PING_PONG */
+#define TICK_RATE_NS        100000000 /* how long to count the ticks per second for */
+#define JOURNAL_LINE        512
+#define JOURNAL_CORRECTION_TOL 0.1 /* max relative change of the pfd correction on --resume */
+#define DEFAULT_CHECK       10	/* % of the cells */
+#define CHECK_TOLERANCE     0.1
 
 
 #define CACHE_LINE_MEM_FILE "/cache_line"
 
-#define B0 _mm_mfence(); barrier_wait(0, ID, test_cores); _mm_mfence();
-#define B1 _mm_mfence(); barrier_wait(2, ID, test_cores); _mm_mfence();
-#define B2 _mm_mfence(); barrier_wait(3, ID, test_cores); _mm_mfence();
-#define B3 _mm_mfence(); barrier_wait(4, ID, test_cores); _mm_mfence();
-#define B4 _mm_mfence(); barrier_wait(5, ID, test_cores); _mm_mfence();
-#define B5 _mm_mfence(); barrier_wait(6, ID, test_cores); _mm_mfence();
-#define B6 _mm_mfence(); barrier_wait(7, ID, test_cores); _mm_mfence();
-#define B7 _mm_mfence(); barrier_wait(8, ID, test_cores); _mm_mfence();
-#define B8 _mm_mfence(); barrier_wait(9, ID, test_cores); _mm_mfence();
-#define B9 _mm_mfence(); barrier_wait(10, ID, test_cores); _mm_mfence();
-#define B10 _mm_mfence(); barrier_wait(11, ID, test_cores); _mm_mfence();
-#define B11 _mm_mfence(); barrier_wait(12, ID, test_cores); _mm_mfence();
-#define B12 _mm_mfence(); barrier_wait(13, ID, test_cores); _mm_mfence();
-#define B13 _mm_mfence(); barrier_wait(14, ID, test_cores); _mm_mfence();
-#define B14 _mm_mfence(); barrier_wait(15, ID, test_cores); _mm_mfence();
+#define B0 _mm_mfence(); barrier_wait(barrier_base + 0, ID, test_cores); _mm_mfence();
+/* the barrier after phase p of a scenario: B1, B2, then B4 ... B9 (B3 ends the repetition) */
+#define BP(p) _mm_mfence(); barrier_wait(barrier_base + ((p) < 2 ? 2 + (p) : 3 + (p)), ID, test_cores); _mm_mfence();
+#define B1 _mm_mfence(); barrier_wait(barrier_base + 2, ID, test_cores); _mm_mfence();
+#define B2 _mm_mfence(); barrier_wait(barrier_base + 3, ID, test_cores); _mm_mfence();
+#define B3 _mm_mfence(); barrier_wait(barrier_base + 4, ID, test_cores); _mm_mfence();
+#define B4 _mm_mfence(); barrier_wait(barrier_base + 5, ID, test_cores); _mm_mfence();
+#define B5 _mm_mfence(); barrier_wait(barrier_base + 6, ID, test_cores); _mm_mfence();
+#define B6 _mm_mfence(); barrier_wait(barrier_base + 7, ID, test_cores); _mm_mfence();
+#define B7 _mm_mfence(); barrier_wait(barrier_base + 8, ID, test_cores); _mm_mfence();
+#define B8 _mm_mfence(); barrier_wait(barrier_base + 9, ID, test_cores); _mm_mfence();
+#define B9 _mm_mfence(); barrier_wait(barrier_base + 10, ID, test_cores); _mm_mfence();
+#define B10 _mm_mfence(); barrier_wait(barrier_base + 11, ID, test_cores); _mm_mfence();
+#define B11 _mm_mfence(); barrier_wait(barrier_base + 12, ID, test_cores); _mm_mfence();
+#define B12 _mm_mfence(); barrier_wait(barrier_base + 13, ID, test_cores); _mm_mfence();
+#define B13 _mm_mfence(); barrier_wait(barrier_base + 14, ID, test_cores); _mm_mfence();
+#define B14 _mm_mfence(); barrier_wait(barrier_base + 15, ID, test_cores); _mm_mfence();
+
+/* the barrier of all the processes of all groups */
+#define BG _mm_mfence(); barrier_wait(BARRIER_GROUP(test_groups), RANK, test_groups * test_cores); _mm_mfence();
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -204,7 +795,7 @@ const char* moesi_type_des[] =
 #  endif
 #endif
 
-inline void
+static inline void
 set_cpu(int cpu) 
 {
 #if defined(__sparc__)
@@ -231,31 +822,12 @@ set_cpu(int cpu)
   }
 #endif
 
-#ifdef OPTERON
-  uint32_t numa_node = cpu/6;
-  numa_set_preferred(numa_node);  
-#elif defined(XEON)
-  uint32_t numa_node = 0;
-  if (cpu == 0)
-    {
-      numa_node = 4;
-    }
-  else if (cpu <= 40)
-    {
-      numa_node = (cpu - 1) / 10;
-    }
-  else
-    {
-      numa_node = cpu / 10;
-    }
-  numa_set_preferred(numa_node);  
-#elif defined(PLATFORM_NUMA)
-  printf("* You need to define how cores correspond to mem nodes in ccbench.h\n");
-#endif 
+  /* allocate the process-local memory on the node of the core */
+  topo_set_preferred(topo_cpu_node(cpu));
   
 }
 
-inline void 
+static inline void 
 wait_cycles(volatile uint64_t cycles)
 {
   /* cycles >>= 1; */
@@ -299,38 +871,6 @@ static inline ticks getticks_correction_calc()
   }
 
 
-  static inline unsigned long* 
-  seed_rand() 
-  {
-    unsigned long* seeds;
-    seeds = (unsigned long*) malloc(3 * sizeof(unsigned long));
-    seeds[0] = getticks() % 123456789;
-    seeds[1] = getticks() % 362436069;
-    seeds[2] = getticks() % 521288629;
-    return seeds;
-  }
-
-extern unsigned long* seeds;
-  //Marsaglia's xorshf generator //period 2^96-1
-static inline unsigned long
-xorshf96(unsigned long* x, unsigned long* y, unsigned long* z) 
-{          
-  unsigned long t;
-  (*x) ^= (*x) << 16;
-  (*x) ^= (*x) >> 5;
-  (*x) ^= (*x) << 1;
-
-  t = *x;
-  (*x) = *y;
-  (*y) = *z;
-  (*z) = t ^ (*x) ^ (*y);
-
-  return *z;
-}
-#define clrand() (xorshf96(seeds, seeds + 1, seeds + 2) & (test_stride - 1))
-#define sirand(range) ((xorshf96(seeds, seeds + 1, seeds + 2) % range) + 64)
-#define my_random(a, b, c) xorshf96(a, b, c)
-
 static inline uint32_t pow2roundup (uint32_t x)
 {
   if (x==0) return 1;
@@ -0,0 +1,71 @@
+/*
+ *   File: ccbench_plugin.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the interface of the plugins that add events to ccbench (--plugin)
+ *   ccbench_plugin.h is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _CCBENCH_PLUGIN_H_
+#define _CCBENCH_PLUGIN_H_
+
+#include <inttypes.h>
+#include "pfd.h"
+
+/* A plugin is a shared object with a CCBENCH_PLUGIN_INIT function that registers its events. */
+/* The events run like the built-in ones: pinned IDs, B0 / the phases / B3 around every */
+/* repetition, a fresh line per repetition if advance is set, and the pfd statistics of store 0 */
+/* of the timed roles. The callbacks time their operations themselves, with PFDI(0) and */
+/* PFDO(0, rep), and can pick a stride-randomized line with ccbench_rand_line(). Build with */
+/*   gcc -shared -fPIC -O3 -I<ccbench>/include -o plugin.so plugin.c (see make plugins) */
+
+#define CCBENCH_PLUGIN_VERSION 1
+#define CCBENCH_PLUGIN_INIT    "ccbench_plugin_init"
+#define CCBENCH_PLUGIN_NAME    32
+
+typedef struct ccbench_event
+{
+  const char* name;		/* for -t, at most CCBENCH_PLUGIN_NAME - 1 chars */
+  uint32_t roles;		/* the IDs 0 .. roles - 1 run the event */
+  uint32_t phases;		/* separated by barriers */
+  uint32_t advance;		/* a fresh line, test_stride further, on every repetition */
+  uint32_t timed;		/* bit r: role r times into store 0, and its statistics are printed */
+  /* every role, once, before the repetitions (may be NULL) */
+  void (*prepare)(volatile void* line, const uint32_t id);
+  /* every role in every phase of repetition rep; the return value goes to the sum */
+  uint64_t (*measure)(volatile void* line, const uint32_t id, const uint32_t phase, const uint64_t rep);
+  /* ID 0, after the statistics (may be NULL) */
+  void (*describe)(void);
+} ccbench_event_t;
+
+/* returns 0 if the event cannot be added */
+typedef int (*ccbench_register_t)(const ccbench_event_t* event);
+
+/* the CCBENCH_PLUGIN_INIT of a plugin: returns 0 on success */
+typedef int (*ccbench_plugin_init_t)(const uint32_t version, ccbench_register_t reg);
+
+/* a random line index below test_stride, from the seeds of the calling ID */
+extern uint32_t ccbench_rand_line();
+
+#endif	/* _CCBENCH_PLUGIN_H_ */
@@ -0,0 +1,87 @@
+/*
+ *   File: cpu.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: runtime detection of the processor and of its features (CPUID, auxv)
+ *   cpu.h is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _CPU_H_
+#define _CPU_H_
+
+#include <inttypes.h>
+#include "common.h"
+
+/* the processors with known defaults (pfd correction, spreading of the threads) */
+typedef enum
+  {
+    CPU_DEFAULT,
+    CPU_OPTERON,		/* AMD family 0x10 */
+    CPU_OPTERON2,		/* AMD family 0x15 and later */
+    CPU_XEON,			/* Intel */
+    CPU_NIAGARA,		/* sun4v */
+    CPU_TILERA,
+    CPU_NUM_PLATFORMS,
+  } cpu_platform_t;
+
+extern const char* cpu_platform_des[];
+
+/* the instructions that the kernels may use */
+#define CPU_RDTSCP        (1 << 0)
+#define CPU_INVARIANT_TSC (1 << 1)
+#define CPU_CLFLUSH       (1 << 2)
+#define CPU_CLFLUSHOPT    (1 << 3)
+#define CPU_CLWB          (1 << 4)
+#define CPU_PREFETCHW     (1 << 5)
+#define CPU_CMPXCHG16B    (1 << 6)
+#define CPU_FENCES        (1 << 7)	/* lfence, sfence, mfence */
+#define CPU_PAUSE         (1 << 8)
+#define CPU_AVX           (1 << 9)	/* 256-bit vectors, enabled by the OS */
+#define CPU_AVX2          (1 << 10)
+#define CPU_AVX512        (1 << 11)	/* 512-bit vectors (AVX-512F), enabled by the OS */
+#define CPU_NUM_FEATURES  12
+
+extern const char* cpu_feature_des[];
+
+typedef struct cpu_info
+{
+  cpu_platform_t platform;
+  char vendor[16];
+  char brand[64];
+  uint32_t family;
+  uint32_t model;
+  uint32_t features;
+  uint32_t vector_bits;		/* the widest usable vector registers */
+  double pfd_correction;	/* the fallback when the calibration is too noisy, 0 = none */
+  int spin_up;			/* spin before the calibration, against frequency scaling */
+} cpu_info_t;
+
+void cpu_init();
+const cpu_info_t* cpu_get();
+int cpu_has(const uint32_t features);
+void cpu_features_str(const uint32_t features, char* buf, const size_t len);
+void cpu_print();
+void cpu_flush(volatile void* p);
+
+#endif	/* _CPU_H_ */
@@ -0,0 +1,146 @@
+/*
+ *   File: kernels.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the timed kernels and their access sequences, shared by ccbench and libccbench
+ *   kernels.h is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include <inttypes.h>
+#include <stdlib.h>
+#if defined(__amd64__)
+#  include <emmintrin.h>
+#endif
+#include "common.h"
+#include "atomic_ops.h"
+#include "pfd.h"
+
+typedef struct cache_line
+{
+  volatile uint32_t word[16];
+} cache_line_t;
+
+/* the lines that the *_eventually kernels access before line 0 in a repetition (see --pattern) */
+typedef enum
+  {
+    ACCESS_NONE,		/* line 0 only */
+    ACCESS_RANDOM,		/* random lines of the stride, repeats allowed */
+    ACCESS_SHUFFLE,		/* distinct random lines of the stride */
+    ACCESS_NUM_PATTERNS,
+  } access_pattern_t;
+
+#define DEFAULT_PATTERN     ACCESS_RANDOM
+#define DEFAULT_DECOYS      16
+#define ACCESS_ROWS         4096 /* the rows of the access sequences, reused modulo */
+#define ACCESS_DECOYS_MAX   1024
+
+/* the parameters of the kernels, defined by the program that runs them (ccbench.c, libccbench.c) */
+extern uint32_t test_reps;
+extern uint32_t test_stride;
+extern uint32_t test_group_lines;
+extern uint32_t test_lfence;
+extern uint32_t test_sfence;
+extern access_pattern_t test_pattern;
+extern uint32_t test_decoys;
+extern __thread unsigned long* seeds;
+
+/* the access sequences of the *_eventually kernels: access_rows rows of access_decoys lines, */
+/* then line 0. Drawn from the stream of the process before the repetitions (access_init) */
+extern __thread uint32_t* access_seq;
+extern __thread uint32_t access_rows;
+extern __thread uint32_t access_decoys;	/* test_decoys, as far as the current stride allows */
+#define ACCESS_ROW(reps) (access_seq + ((reps) % access_rows) * (access_decoys + 1))
+
+/* the fenced kernels are selected once per fence level by kernels_select */
+typedef void (*store_kernel_t)(volatile cache_line_t* cl, volatile uint64_t reps);
+typedef uint64_t (*load_kernel_t)(volatile cache_line_t* cl, volatile uint64_t reps);
+typedef uint64_t (*chase_kernel_t)(volatile uint64_t* cl, volatile uint64_t reps);
+
+extern store_kernel_t store_0, store_0_no_pf, store_0_eventually, store_0_eventually_pfd1;
+extern load_kernel_t load_0, load_0_eventually;
+extern chase_kernel_t load_next;
+
+void kernels_select();
+uint32_t decoys_fit(const uint32_t stride);
+void access_init();
+
+uint32_t cas(volatile cache_line_t* cl, volatile uint64_t reps);
+uint32_t cas_no_pf(volatile cache_line_t* cl, volatile uint64_t reps);
+uint32_t cas_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps);
+uint32_t fai(volatile cache_line_t* cl, volatile uint64_t reps);
+uint8_t tas(volatile cache_line_t* cl, volatile uint64_t reps);
+uint32_t swap(volatile cache_line_t* cl, volatile uint64_t reps);
+uint64_t load_0_eventually_no_pf(volatile cache_line_t* cl, volatile uint64_t reps);
+void invalidate(volatile cache_line_t* cl, uint64_t index, volatile uint64_t reps);
+
+/* splitmix64: spreads a seed over the state of xorshf96 */
+static inline uint64_t
+splitmix64(uint64_t* x)
+{
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/* the seeds of random stream number stream of seed: every process (RANK + 1) and main (0) */
+/* has its own, and the same seed gives the same streams on every host */
+static inline unsigned long* 
+seed_rand(const uint64_t seed, const uint32_t stream) 
+{
+  unsigned long* seeds;
+  seeds = (unsigned long*) malloc(3 * sizeof(unsigned long));
+  uint64_t x = seed ^ ((uint64_t) stream * 0xD1B54A32D192ED03ULL);
+  uint32_t i;
+  for (i = 0; i < 3; i++)
+    {
+      seeds[i] = splitmix64(&x) | 1;	/* xorshf96 must not start from 0 */
+    }
+  return seeds;
+}
+
+  //Marsaglia's xorshf generator //period 2^96-1
+static inline unsigned long
+xorshf96(unsigned long* x, unsigned long* y, unsigned long* z) 
+{          
+  unsigned long t;
+  (*x) ^= (*x) << 16;
+  (*x) ^= (*x) >> 5;
+  (*x) ^= (*x) << 1;
+
+  t = *x;
+  (*x) = *y;
+  (*y) = *z;
+  (*z) = t ^ (*x) ^ (*y);
+
+  return *z;
+}
+#define clrand() (xorshf96(seeds, seeds + 1, seeds + 2) & (test_stride - 1))
+#define sirand(range) ((xorshf96(seeds, seeds + 1, seeds + 2) % range) + 64)
+#define my_random(a, b, c) xorshf96(a, b, c)
+
+#endif	/* _KERNELS_H_ */
@@ -0,0 +1,107 @@
+/*
+ *   File: libccbench.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the C API of libccbench, the measurement machinery of ccbench as a library
+ *   libccbench.h is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LIBCCBENCH_H_
+#define _LIBCCBENCH_H_
+
+#include <inttypes.h>
+
+/* libccbench measures one operation on a cache line that other cores have brought into a */
+/* given state, with the pinned threads, the barriers, and the pfd timing of ccbench. */
+/* cores[0] measures, cores[1] owns the line, and cores[2] shares it. One session at a time. */
+/* The states are prepared and the operations timed with the kernels of ccbench (kernels.c), */
+/* with its default stride and access sequences (random:16, the same seed in every session) */
+/* and no fences, like the ccbench events on one line with -f. Only the ccb_ symbols are */
+/* exported: */
+/*
+ *   uint32_t cores[] = { 0, 8, 16 };
+ *   ccb_session_t* s = ccb_session_create(cores, 3, 1000);
+ *   ccb_stats_t st;
+ *   if (s != NULL && ccb_run(s, CCB_SHARED, CCB_CAS, 1000, &st) == 0) ... st.median ...
+ *   ccb_session_destroy(s);
+ *
+ * link with -lccbench -lpthread -lm -lrt
+ */
+
+#if defined(__GNUC__)
+#  define CCB_API __attribute__((visibility("default")))
+#else
+#  define CCB_API
+#endif
+
+/* the state of the line when cores[0] runs the operation */
+typedef enum
+  {
+    CCB_MODIFIED,		/* stored by cores[1] */
+    CCB_OWNED,			/* stored by cores[1], then loaded by cores[2] */
+    CCB_EXCLUSIVE,		/* loaded by cores[1] only */
+    CCB_SHARED,			/* loaded by cores[1] and cores[2] */
+    CCB_INVALID,		/* in no cache (flushed) */
+    CCB_LOCAL,			/* loaded by cores[0] itself */
+    CCB_NUM_STATES,
+  } ccb_state_t;
+
+typedef enum
+  {
+    CCB_LOAD,
+    CCB_STORE,
+    CCB_CAS,
+    CCB_FAI,
+    CCB_TAS,
+    CCB_SWAP,
+    CCB_NUM_OPS,
+  } ccb_op_t;
+
+/* the statistics of the repetitions, in cycles (ticks) without the timing overhead */
+typedef struct ccb_stats
+{
+  uint32_t num;
+  double avg;
+  double median;
+  double std_dev;
+  double abs_dev;
+  double min;
+  double max;
+} ccb_stats_t;
+
+typedef struct ccb_session ccb_session_t;
+
+/* pins one thread per core and calibrates the timing for up to max_reps repetitions. */
+/* Returns NULL (and errno) on failure */
+CCB_API ccb_session_t* ccb_session_create(const uint32_t* cores, const uint32_t num_cores, const uint32_t max_reps);
+/* runs op reps times, on a line in state before every repetition. Returns 0, or -1 (and */
+/* errno = EINVAL) if the state needs more cores than the session has or reps > max_reps */
+CCB_API int ccb_run(ccb_session_t* s, const ccb_state_t state, const ccb_op_t op, const uint32_t reps,
+		    ccb_stats_t* stats);
+CCB_API void ccb_session_destroy(ccb_session_t* s);
+
+CCB_API const char* ccb_state_name(const ccb_state_t state);
+CCB_API const char* ccb_op_name(const ccb_op_t op);
+
+#endif	/* _LIBCCBENCH_H_ */
@@ -120,20 +120,28 @@ typedef struct abs_deviation
 } abs_deviation_t;
 
 
-#define PFD_NUM_STORES 2
+#define PFD_NUM_STORES 4
 #define PFD_PRINT_MAX 200
+#define PFD_STORE_ALIGN 4096
 
-extern volatile ticks** pfd_store;
-extern volatile ticks* _pfd_s;
-extern volatile ticks pfd_correction;
+/* per process, or per thread with --threads */
+extern __thread volatile ticks** pfd_store;
+extern __thread volatile ticks* _pfd_s;
+extern __thread volatile ticks pfd_correction;
+/* per process, set before the calibration: the correction when the calibration is too noisy */
+/* (0 = none), and whether to spin first, against frequency scaling */
+extern double pfd_correction_fallback;
+extern int pfd_spin_up;
 #if !defined(DO_TIMINGS)
 #  define PFDINIT(num_entries) 
+#  define PFDTERM() 
 #  define PFDI(store) 
 #  define PFDO(store, entry) 
 #  define PFDP(store, num_vals) 
 #  define PFDPN(store, num_vals, num_print)
 #else  /* DO_TIMINGS */
 #  define PFDINIT(num_entries) pfd_store_init(num_entries)
+#  define PFDTERM() pfd_store_term()
 
 #  define PFDI(store)				\
   {						\
@@ -172,11 +180,94 @@ extern volatile ticks pfd_correction;
   PFDI(store);					\
   PFDO(store, entry);
 
+/* the timed regions of the kernels. On x86_64, PFDT is one asm block: rdtsc, the body, rdtsc, */
+/* with the line in rdi, the value in rcx, and the argument in r8, so the timed instructions do */
+/* not depend on the compiler or on the -O level. Every instance is recorded in the */
+/* pfd_regions section, for --verify-kernels. Elsewhere PFDT is PFDI, the C op, PFDO */
+#if defined(__x86_64__)
+#  define PFD_ASM
+
+typedef struct pfd_region
+{
+  const uint8_t* start;		/* after the rdtsc that starts the region */
+  const uint8_t* end;		/* at the rdtsc that ends it */
+  const char* name;
+} pfd_region_t;
+
+#  define PFD_REGION_RECORD(name)			\
+  ".pushsection .rodata\n"				\
+  "663: .asciz \"" name "\"\n"				\
+  ".popsection\n"					\
+  ".pushsection pfd_regions, \"aw\"\n"			\
+  ".balign 8\n"						\
+  ".quad 661b, 662b, 663b\n"				\
+  ".popsection\n"
+
+#  define PFDAR(store, entry, reps, name, body, val, ptr, arg)	\
+  {								\
+    uint64_t _t, _v = (val);					\
+    const volatile void* _p = (ptr);				\
+    register uint64_t _a asm ("r8") = (arg);			\
+    asm volatile ("rdtsc\n\t"					\
+		  "661:\n\t"					\
+		  "shl $32, %%rdx\n\t"				\
+		  "or %%rdx, %%rax\n\t"				\
+		  "mov %%rax, %%rsi\n\t"			\
+		  body						\
+		  "662:\n\t"					\
+		  "rdtsc\n\t"					\
+		  "shl $32, %%rdx\n\t"				\
+		  "or %%rdx, %%rax\n\t"				\
+		  "sub %%rsi, %%rax\n\t"			\
+		  PFD_REGION_RECORD(name)			\
+		  : "=&a" (_t), "+c" (_v), "+D" (_p), "+r" (_a)	\
+		  :						\
+		  : "rdx", "rsi", "memory", "cc");		\
+    (val) = _v;							\
+    pfd_store[store][entry] = (_t - pfd_correction) / (reps);	\
+  }
+
+#  define PFDT(store, entry, name, body, op, val, ptr, arg)	\
+  PFDAR(store, entry, 1, name, body, val, ptr, arg)
+#  define PFDTR(store, entry, reps, name, body, op, val, ptr, arg)	\
+  PFDAR(store, entry, reps, name, body, val, ptr, arg)
+
+/* the bodies: the value is in ecx, the CAS swaps in r8d, the chase walks r8d pointers */
+#  define PFD_ASM_LOAD "movl (%%rdi), %%ecx\n\t"
+#  define PFD_ASM_STORE "movl %%ecx, (%%rdi)\n\t"
+#  define PFD_ASM_STORE2 "movl %%ecx, (%%rdi)\n\tmovl %%ecx, 64(%%rdi)\n\t"
+#  define PFD_ASM_CAS "movl %%ecx, %%eax\n\tlock cmpxchgl %%r8d, (%%rdi)\n\tmovl %%eax, %%ecx\n\t"
+#  define PFD_ASM_FAI "lock xaddl %%ecx, (%%rdi)\n\t"
+#  define PFD_ASM_TAS "xchgb %%cl, (%%rdi)\n\t"
+#  define PFD_ASM_SWAP "xchgl %%ecx, (%%rdi)\n\t"
+#  define PFD_ASM_CLFLUSH "clflush (%%rdi)\n\t"
+#  define PFD_ASM_CHASE(fence) "1:\n\tmovq (%%rdi), %%rdi\n\t" fence "decl %%r8d\n\tjnz 1b\n\t"
+#  define PFD_ASM_LFENCE "lfence\n\t"
+#  define PFD_ASM_SFENCE "sfence\n\t"
+#  define PFD_ASM_MFENCE "mfence\n\t"
+#  define PFD_ASM_PAUSE "pause\n\t"
+#  define PFD_ASM_NOP "nop\n\t"
+#  define PFD_ASM_EMPTY ""
+#else
+#  define PFDT(store, entry, name, body, op, val, ptr, arg)	\
+  (void) (val);							\
+  PFDI(store);							\
+  op;								\
+  PFDO(store, entry);
+#  define PFDTR(store, entry, reps, name, body, op, val, ptr, arg)	\
+  (void) (val);								\
+  PFDI(store);								\
+  op;									\
+  PFDOR(store, entry, reps);
+#endif	/* __x86_64__ */
+
 
 
 void pfd_store_init(const uint32_t num_entries);
+void pfd_store_term();
 void get_abs_deviation(volatile ticks* vals, const size_t num_vals, abs_deviation_t* abs_dev);
 void print_abs_deviation(const abs_deviation_t* abs_dev);
+double get_median(volatile ticks* vals, const size_t num_vals);
 
 
 #endif	/* _PFD_H_ */
@@ -0,0 +1,86 @@
+/*
+ *   File: topology.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: discovery of the processor topology (sysfs) and of the latency domains
+ *   topology.h is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "common.h"
+
+#define TOPO_SYSFS_CPU "/sys/devices/system/cpu"
+#define TOPO_SYSFS_NODE "/sys/devices/system/node"
+#define TOPO_CLUSTER_GAP 0.15	/* min relative latency gap between two latency domains */
+
+/* the distance classes of a pair of cores, from the closest to the furthest */
+typedef enum
+  {
+    TOPO_SAME_CORE,		/* SMT siblings */
+    TOPO_SAME_L2,
+    TOPO_SAME_LLC,
+    TOPO_SAME_SOCKET,
+    TOPO_REMOTE_SOCKET,
+    TOPO_NUM_CLASSES,
+  } topo_class_t;
+
+extern const char* topo_class_des[];
+
+typedef struct topo_cpu
+{
+  uint32_t cpu;
+  int32_t package;
+  int32_t core_id;
+  int32_t smt_id;		/* the first cpu of the thread siblings */
+  int32_t l2_id;		/* the first cpu sharing the L2 */
+  int32_t llc_id;		/* the first cpu sharing the last-level cache */
+  int32_t node;			/* the NUMA node of the cpu, -1 if unknown */
+} topo_cpu_t;
+
+int topo_init(const uint32_t* cpus, const uint32_t num_cpus);
+uint32_t topo_num_cpus();
+const topo_cpu_t* topo_get(const uint32_t cpu);
+topo_class_t topo_pair_class(const uint32_t c1, const uint32_t c2);
+int topo_representative(const topo_class_t cls, const uint32_t c1, const uint32_t* excl,
+			const uint32_t num_excl, uint32_t* c2);
+void topo_print();
+
+int32_t topo_cpu_node(const uint32_t cpu);
+uint32_t topo_num_nodes();
+int topo_node_valid(const int32_t node);
+int32_t topo_node_distance(const int32_t n1, const int32_t n2);
+void topo_set_preferred(const int32_t node);
+int topo_mem_bind(volatile void* mem, const size_t size, const int32_t node);
+
+uint32_t topo_cluster(const uint32_t* c1, const uint32_t* c2, const double* lat, const uint32_t num);
+int32_t topo_pair_domain(const uint32_t c1, const uint32_t c2);
+void topo_print_domains();
+
+uint32_t parse_cpu_list(const char* list, uint32_t** cpus);
+
+#endif	/* _TOPOLOGY_H_ */
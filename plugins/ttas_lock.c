@@ -0,0 +1,97 @@
+/*
+ *   File: ttas_lock.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: an example plugin: the handoff of a test-and-test-and-set lock
+ *   ttas_lock.c is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ccbench_plugin.h"
+#include "atomic_ops.h"
+
+/* TTAS_HANDOFF: ID 0 holds the lock and releases it in phase 0, ID 1 spins on the lock word */
+/* with loads and acquires it in phase 1 (timed), then releases it for the next repetition */
+
+static void
+ttas_prepare(volatile void* line, const uint32_t id)
+{
+  if (id == 0)
+    {
+      *(volatile uint32_t*) line = 0;
+    }
+}
+
+static uint64_t
+ttas_measure(volatile void* line, const uint32_t id, const uint32_t phase, const uint64_t rep)
+{
+  volatile uint32_t* lock = (volatile uint32_t*) line;
+  uint64_t spins = 0;
+
+  if (id == 0 && phase == 0)
+    {
+      /* take the lock and hand it over */
+      while (CAS_U32(lock, 0, 1) != 0)
+	;
+      *lock = 0;
+    }
+  else if (id == 1 && phase == 1)
+    {
+      PFDI(0);
+      while (1)
+	{
+	  while (*lock != 0)
+	    {
+	      spins++;
+	    }
+	  if (CAS_U32(lock, 0, 1) == 0)
+	    {
+	      break;
+	    }
+	}
+      PFDO(0, rep);
+      *lock = 0;
+    }
+  return spins;
+}
+
+static void
+ttas_describe(void)
+{
+  printf("[00]  ** Results from Core 1 : TTAS acquire of a lock just released by core 0\n");
+}
+
+static const ccbench_event_t ttas_handoff =
+  {
+    "TTAS_HANDOFF", 2, 2, 0, 0x2, ttas_prepare, ttas_measure, ttas_describe
+  };
+
+int
+ccbench_plugin_init(const uint32_t version, ccbench_register_t reg)
+{
+  if (version != CCBENCH_PLUGIN_VERSION)
+    {
+      return 1;
+    }
+  return !reg(&ttas_handoff);
+}
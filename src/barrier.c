@@ -47,6 +47,8 @@
 #endif	/* __sparc__ */
 
 barrier_t* barriers;
+uint32_t barriers_num = NUM_BARRIERS;
+static int barriers_private = 0;	/* threads instead of processes (anonymous memory) */
 
 
 int color_all(int id)
@@ -54,16 +56,10 @@ int color_all(int id)
   return 1;
 }
 
-void
-barriers_init(const uint32_t num_procs)
+/* the barriers of processes: in the BARRIER_MEM_FILE shm object */
+static void*
+barriers_shm(const uint32_t size)
 {
-  uint32_t size;
-  size = NUM_BARRIERS * sizeof(barrier_t);
-  if (size < 8192)
-    {
-      size = 8192;
-    }
-
   char keyF[100];
   sprintf(keyF, BARRIER_MEM_FILE);
 
@@ -84,13 +80,12 @@ barriers_init(const uint32_t num_procs)
 	  exit(1);
 	}
     }
-  else
-    {
-      if (ftruncate(barrierfd, size) < 0) {
-	perror("ftruncate failed\n");
-	exit(1);
-      }
-    }
+
+  /* also when it exists: a stale object could be smaller than what we need */
+  if (ftruncate(barrierfd, size) < 0) {
+    perror("ftruncate failed\n");
+    exit(1);
+  }
 
   void* mem = (void*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, barrierfd, 0);
   if (mem == NULL)
@@ -99,10 +94,57 @@ barriers_init(const uint32_t num_procs)
       exit(134);
     }
 
+  return mem;
+}
+
+/* num_groups groups of num_procs processes each get NUM_BARRIERS barriers. One more */
+/* group of barriers, BARRIER_GROUP(num_groups), is shared by all the processes. With */
+/* private_mem, the processes are threads of this process and the memory is anonymous */
+void
+barriers_init(const uint32_t num_procs, const uint32_t num_groups, const int private_mem)
+{
+  barriers_num = (num_groups + 1) * NUM_BARRIERS;
+  uint32_t size;
+  size = barriers_num * sizeof(barrier_t);
+  if (size < 8192)
+    {
+      size = 8192;
+    }
+
+  barriers_private = private_mem;
+  void* mem;
+  if (private_mem)
+    {
+      /* the threads of one process: anonymous memory, nothing to unlink */
+      mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mem == MAP_FAILED)
+	{
+	  perror("barriers mmap");
+	  exit(134);
+	}
+    }
+  else
+    {
+      mem = barriers_shm(size);
+    }
+
   barriers = (barrier_t*) mem;
 
   uint32_t bar;
-  for (bar = 0; bar < NUM_BARRIERS; bar++) 
+  for (bar = 0; bar < barriers_num; bar++) 
+    {
+      uint32_t procs = (bar < BARRIER_GROUP(num_groups)) ? num_procs : num_procs * num_groups;
+      barrier_init(bar, 0, color_all, procs);
+    }
+}
+
+/* changes the participants of the group of barriers that starts at base. No process may be */
+/* in any of these barriers */
+void
+barriers_resize(const uint32_t base, const uint32_t num_procs)
+{
+  uint32_t bar;
+  for (bar = base; bar < base + NUM_BARRIERS; bar++) 
     {
       barrier_init(bar, 0, color_all, num_procs);
     }
@@ -112,7 +154,7 @@ void
 barrier_init(const uint32_t barrier_num, const uint64_t participants, int (*color)(int),
 	     const uint32_t total_cores) 
 {
-  if (barrier_num >= NUM_BARRIERS) 
+  if (barrier_num >= barriers_num) 
     {
       return;
     }
@@ -136,7 +178,7 @@ void
 barrier_wait(const uint32_t barrier_num, const uint32_t id, const uint32_t total_cores) 
 {
   _mm_mfence();
-  if (barrier_num >= NUM_BARRIERS) 
+  if (barrier_num >= barriers_num) 
     {
       return;
     }
@@ -191,7 +233,7 @@ barrier_wait(const uint32_t barrier_num, const uint32_t id, const uint32_t total
 void
 barriers_term(const uint32_t id) 
 {
-  if (id == 0)
+  if (id == 0 && !barriers_private)
     {
       shm_unlink(BARRIER_MEM_FILE);
     }
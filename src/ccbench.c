@@ -29,20 +29,26 @@
 
 #include "ccbench.h"
 
-uint8_t ID;
-unsigned long* seeds;
+/* per process, or per thread with --threads */
+__thread uint32_t ID;
+__thread uint32_t GID;		/* the group of the process (see --parallel) */
+__thread uint32_t RANK;		/* the rank of the process among all groups */
+__thread uint32_t barrier_base;	/* the first barrier of the group */
+__thread unsigned long* seeds;
 
 #if defined(__tile__)
 cpu_set_t cpus;
 #endif
 
-moesi_type_t test_test = DEFAULT_TEST;
+__thread moesi_type_t test_test = DEFAULT_TEST; /* run_cells changes it per cell */
 uint32_t test_cores = DEFAULT_CORES;
 uint32_t test_reps = DEFAULT_REPS;
 uint32_t test_core1 = DEFAULT_CORE1;
 uint32_t test_core2 = DEFAULT_CORE2;
 uint32_t test_core3 = DEFAULT_CORE3;
 uint32_t test_core_others = DEFAULT_CORE_OTHERS;
+uint32_t* test_roles = NULL;	/* the core of every ID (--cpus), else core1/2/3 and core-others */
+uint32_t test_roles_num = 0;
 uint32_t test_flush = DEFAULT_FLUSH;
 uint32_t test_verbose = DEFAULT_VERBOSE;
 uint32_t test_print = DEFAULT_PRINT;
@@ -53,28 +59,128 @@ size_t   test_mem_size = CACHE_LINE_NUM * sizeof(cache_line_t);
 uint32_t test_cache_line_num = CACHE_LINE_NUM;
 uint32_t test_lfence = DEFAULT_LFENCE;
 uint32_t test_sfence = DEFAULT_SFENCE;
+uint32_t test_matrix = DEFAULT_MATRIX;
+uint32_t test_topology = DEFAULT_TOPOLOGY;
+uint32_t test_sweep3 = DEFAULT_SWEEP3;
+uint32_t test_characterize = DEFAULT_CHARACTERIZE;
+uint32_t test_smt = DEFAULT_SMT;
+uint32_t test_home = DEFAULT_HOME;
+uint32_t test_dram = DEFAULT_DRAM;
+uint32_t test_saturate = DEFAULT_SATURATE;
+uint32_t test_threads = DEFAULT_THREADS;
+char*    test_server = NULL;	/* the Unix socket of --server */
+char*    test_batch = NULL;	/* the test file of --batch */
+char*    test_scenario = NULL;	/* the file of --scenario */
+scenario_t test_script;		/* what --scenario runs instead of the scenario of test_test */
+char     test_script_name[SCEN_NAME];
+char     test_script_stores[PFD_NUM_STORES][SCEN_NAME]; /* the names of the sample stores */
+uint32_t test_script_stores_num = 0;
+char*    test_event = NULL;	/* -t, resolved once the plugins are loaded */
+ccbench_event_t plugin_events[PLUGIN_EVENTS_MAX]; /* the events of --plugin: NUM_EVENTS + i */
+char     plugin_names[PLUGIN_EVENTS_MAX][CCBENCH_PLUGIN_NAME];
+uint32_t plugin_events_num = 0;
+const ccbench_event_t* test_plugin = NULL; /* the plugin event of -t, if any */
+scenario_t plugin_scen;		/* the scenario of test_plugin */
+uint32_t test_home_slots = 1;	/* with --home, every group has cache lines on every node */
+corunner_t* corunners = NULL;	/* one per group, with --smt */
+int32_t  test_mem_node = DEFAULT_MEM_NODE;
+uint32_t test_groups = DEFAULT_GROUPS;
+uint32_t test_epoch = DEFAULT_EPOCH;
+uint64_t test_seed = 0;
+uint32_t test_seed_set = 0;
+access_pattern_t test_pattern = DEFAULT_PATTERN;
+uint32_t test_decoys = DEFAULT_DECOYS;
+uint32_t test_check = DEFAULT_CHECK;
+uint32_t test_sample = DEFAULT_SAMPLE;
+char*    test_journal = NULL;	/* the file of the completed cells (--journal / --resume) */
+uint32_t test_resume = 0;
+int      journal_fd = -1;
+uint32_t test_group_lines = CACHE_LINE_NUM; /* the cache lines of every group */
+uint32_t* test_cpus = NULL;	/* the online cpus that we are allowed to run on */
+uint32_t test_cpus_num = 0;
+
+
+static int verify_kernels();
+static int pattern_parse(const char* s);
+
+static void ping_pong_0(volatile cache_line_t* cl, volatile uint64_t reps);
+static void ping_pong_1(volatile cache_line_t* cl, volatile uint64_t reps);
 
 
-static void store_0(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static void store_0_no_pf(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static void store_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps);
-static void store_0_eventually_pfd1(volatile cache_line_t* cl, volatile uint64_t reps);
-
-static uint64_t load_0(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static uint64_t load_next(volatile uint64_t* cl, volatile uint64_t reps);
-static uint64_t load_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps);
-static uint64_t load_0_eventually_no_pf(volatile cache_line_t* cl);
-
-static void invalidate(volatile cache_line_t* cache_line, uint64_t index, volatile uint64_t reps);
-static uint32_t cas(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static uint32_t cas_0_eventually(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static uint32_t cas_no_pf(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static uint32_t fai(volatile cache_line_t* cache_line, volatile uint64_t reps);
-static uint8_t tas(volatile cache_line_t* cl, volatile uint64_t reps);
-static uint32_t swap(volatile cache_line_t* cl, volatile uint64_t reps);
-
 static size_t parse_size(char* optarg);
 static void create_rand_list_cl(volatile uint64_t* list, size_t n);
+static void cache_line_reset(volatile cache_line_t* cache_line, const uint32_t num_lines);
+
+static int ccbench_role(const uint32_t rank, const run_t* run);
+static void* ccbench_thread(void* arg);
+static uint64_t run_test(volatile cache_line_t** cache_linep);
+static void scenario_plan(const scenario_t* scen, const uint32_t id, scen_plan_t* plan);
+static void scenario_describe(const scenario_t* scen);
+static const scenario_t* scenario_get(const moesi_type_t event);
+static uint32_t script_load(const char* path, char* err, const size_t len);
+static void plugin_load(const char* path);
+static int32_t plugin_event(const char* name);
+static int32_t event_parse(const char* s);
+static void plugin_scenario(const ccbench_event_t* event, scenario_t* scen);
+static int test_advances(const moesi_type_t event);
+static uint32_t test_missing(const moesi_type_t event, const uint32_t fence);
+static const char* fence_levels(const uint32_t fence, uint32_t* lfence, uint32_t* sfence);
+static const char* fence_set(const uint32_t fence);
+static int server_open(const char* path);
+static void serve(volatile cache_line_t* cache_line, request_t* req, const int sock);
+static int test_fits(const moesi_type_t event);
+static uint32_t online_cpus(uint32_t** cpus);
+static size_t role_core(const uint32_t id, const cell_t* cell);
+static int cell_mode();
+static uint32_t event_procs(const moesi_type_t event);
+static int core_allowed(const size_t core);
+static void check_core(const size_t core, const char* role);
+static uint32_t matrix_cells(cell_t** cells);
+static uint32_t sweep3_cells(cell_t** cells);
+static uint32_t home_nodes_get(int32_t* nodes);
+static uint32_t home_cells(cell_t** cells, int32_t* nodes);
+static uint32_t dram_cells(cell_t** cells, int32_t* nodes);
+static void print_dram(const cell_t* cells, const cell_res_t* res, const int32_t* nodes, 
+		       const uint32_t num_nodes);
+static void print_home(const cell_t* cells, const cell_res_t* res, const int32_t* nodes, 
+		       const uint32_t num_nodes);
+static uint32_t saturate_pairs(const uint32_t variant, uint32_t* a, uint32_t* b);
+static uint32_t saturate_cells(cell_t** cells, uint32_t* num_pairs);
+static void saturate_schedule(schedule_t* sched, const cell_t* cells, const uint32_t* num_pairs, 
+			      const cell_res_t* skip);
+static void print_saturate(const cell_t* cells, const cell_res_t* res, const uint32_t* num_pairs);
+static uint32_t node_slot(const int32_t node);
+static uint32_t characterize_cols(char_col_t* cols);
+static uint32_t smt_cols(char_col_t* cols);
+static uint32_t characterize_cells(cell_t** cells, const char_col_t* cols, const uint32_t num_cols);
+static void corunners_start(const uint32_t num);
+static void corunners_stop(const uint32_t num);
+static void print_characterize(const cell_t* cells, const cell_res_t* res, const char_col_t* cols, 
+			       const uint32_t num_cols);
+static uint32_t sample_cells(const cell_t* matrix, const uint32_t matrix_num, cell_t** cells, 
+			     uint32_t** sample_of);
+static cell_res_t* infer_matrix(const cell_t* matrix, const uint32_t matrix_num, const cell_res_t* res,
+				const uint32_t* sample_of, const uint32_t num_cells);
+static cell_res_t* results_open(const uint32_t num_cells);
+static void schedule_cells(schedule_t* sched, const cell_t* cells, const uint32_t first, 
+			   const uint32_t num, const uint32_t groups, const cell_res_t* skip);
+static uint32_t check_cells(cell_t** cells, const uint32_t num_cells, uint32_t** check_of);
+static void check_report(const cell_t* cells, cell_res_t* res, const uint32_t num_cells, 
+			 const uint32_t* check_of, const uint32_t num_check);
+static void run_cells(volatile cache_line_t* cache_line, const cell_t* cells, cell_res_t* res, 
+		      const schedule_t* sched, const uint32_t num_cells);
+static int journal_seed(const char* path, uint64_t* seed);
+static uint32_t journal_resume(const char* path, const cell_t* cells, const uint32_t num_cells, 
+			       cell_res_t* res, double* correction);
+static void journal_open(const char* path);
+static int journal_calibrate(const double correction);
+static void journal_cell(const uint32_t idx, const cell_t* cell, const cell_res_t* res);
+static void print_matrix(const cell_t* cells, const cell_res_t* res, const uint32_t rows, 
+			 const uint32_t cols);
+static void print_matrix_source(const cell_t* cells, const cell_res_t* res, const uint32_t rows, 
+				const uint32_t cols);
+static void cluster_matrix(const cell_t* cells, const cell_res_t* res, const uint32_t num_cells);
+static void print_sweep3(const cell_t* cells, const cell_res_t* res, const uint32_t num_cells);
 
 
 int
@@ -89,11 +195,12 @@ main(int argc, char **argv)
     }
 #endif
 
-#if defined(XEON)
-  set_cpu(1);
-#else
-  set_cpu(0);
-#endif
+  test_cpus_num = online_cpus(&test_cpus);
+  set_cpu(test_cpus[0]);
+
+  cpu_init();
+  pfd_correction_fallback = cpu_get()->pfd_correction;
+  pfd_spin_up = cpu_get()->spin_up;
 
   struct option long_options[] = 
     {
@@ -106,6 +213,7 @@ main(int argc, char **argv)
       {"core2",                     required_argument, NULL, 'y'},
       {"core3",                     required_argument, NULL, 'z'},
       {"core-others",               required_argument, NULL, 'o'},
+      {"cpus",                      required_argument, NULL, 'L'},
       {"stride",                    required_argument, NULL, 's'},
       {"fence",                     required_argument, NULL, 'e'},
       {"mem-size",                  required_argument, NULL, 'm'},
@@ -113,15 +221,39 @@ main(int argc, char **argv)
       {"success",                   no_argument,       NULL, 'u'},
       {"verbose",                   no_argument,       NULL, 'v'},
       {"print",                     required_argument, NULL, 'p'},
+      {"matrix",                    required_argument, NULL, 'M'},
+      {"topology",                  required_argument, NULL, 'T'},
+      {"mem-node",                  required_argument, NULL, 'N'},
+      {"sweep3",                    no_argument,       NULL, 'S'},
+      {"characterize",              no_argument,       NULL, 'C'},
+      {"smt",                       required_argument, NULL, 'H'},
+      {"home",                      no_argument,       NULL, 'W'},
+      {"dram",                      no_argument,       NULL, 'D'},
+      {"saturate",                  no_argument,       NULL, 'Q'},
+      {"threads",                   no_argument,       NULL, 'X'},
+      {"server",                    required_argument, NULL, 'd'},
+      {"batch",                     required_argument, NULL, 'b'},
+      {"scenario",                  required_argument, NULL, 'I'},
+      {"plugin",                    required_argument, NULL, 'l'},
+      {"parallel",                  required_argument, NULL, 'P'},
+      {"check",                     required_argument, NULL, 'K'},
+      {"sample",                    required_argument, NULL, 'A'},
+      {"journal",                   required_argument, NULL, 'J'},
+      {"resume",                    required_argument, NULL, 'R'},
+      {"verify-kernels",            no_argument,       NULL, 'V'},
+      {"epoch",                     required_argument, NULL, 'E'},
+      {"seed",                      required_argument, NULL, 'g'},
+      {"pattern",                   required_argument, NULL, 'G'},
       {NULL, 0, NULL, 0}
     };
 
   int i;
   char c;
+  int cores_set = 0;
   while(1) 
     {
       i = 0;
-      c = getopt_long(argc, argv, "hc:r:t:x:m:y:z:o:e:fvup:s:", long_options, &i);
+      c = getopt_long(argc, argv, "hc:r:t:x:m:y:z:o:L:e:fvup:s:M:T:N:SCH:WDQXd:b:I:l:P:K:A:J:R:VE:g:G:", long_options, &i);
 
       if(c == -1)
 	break;
@@ -161,6 +293,9 @@ main(int argc, char **argv)
 		 "        3rd core to use. Some (most) tests use only 2 cores (default=" XSTR(DEFAULT_CORE3) ")\n"
 		 "  -o, --core-others <int>\n"
 		 "        Offset for core that the processes with ID > 3 should bind (default=" XSTR(DEFAULT_CORE_OTHERS) ")\n"
+		 "  -L, --cpus <list>\n"
+		 "        The core of every ID, e.g., 0-15,64-79 (ID 0 on 0, ID 16 on 64). Sets core1/2/3 and, without\n"
+		 "        -c, the number of cores. Every core must be in the affinity mask of ccbench\n"
 		 "  -f, --flush\n"
 		 "        Perform a cache line flush before the test (default=" XSTR(DEFAULT_FLUSH) ")\n"
 		 "  -s, --stride <int>\n"
@@ -174,29 +309,126 @@ main(int argc, char **argv)
 		 "        5 = full-none fences / 6 = none-full fences / 7 = full-store fences / 8 = load-full fences \n"
 		 "  -m, --mem-size <int>\n"
 		 "        What memory size to use (in cache lines) (default=" XSTR(CACHE_LINE_NUM) ")\n"
+		 "  -S, --sweep3\n"
+		 "        Three-party sweep: the requester runs on core1 and the owner and the sharer of the line are\n"
+		 "        placed at every distance class from it. Runs the given test if it is a three-party event\n"
+		 "        (e.g., LOAD_FROM_OWNED, *_ON_SHARED), else all three-party events\n"
+		 "  -C, --characterize\n"
+		 "        Run every event with the measuring core on core1 and the other cores at one representative\n"
+		 "        core per distance class (and per node distance for the remote sockets), and print a table\n"
+		 "        of event x distance\n"
+		 "  -H, --smt <int>\n"
+		 "        Like -C, with the columns: the other cores on the SMT sibling of core1 / on the closest\n"
+		 "        other core / on the closest other core while a co-runner keeps the sibling of core1 busy\n"
+		 "        1 = the co-runner spins on the ALU / 2 = the co-runner streams over " XSTR(CORUNNER_MEM) " bytes\n"
+		 "  -W, --home\n"
+		 "        Measure the test for every owner node x home node x requester node: the cache lines are\n"
+		 "        bound to the home node, the owner (and the sharer) and the requester of the line run on the\n"
+		 "        first cpus of their nodes\n"
+		 "  -D, --dram\n"
+		 "        LOAD_FROM_MEM_SIZE from every core on a pointer-chasing list bound to every node, and print\n"
+		 "        the core x node table of the unloaded memory latency. Every node gets 1/#nodes of the\n"
+		 "        memory size, which should be well above the size of the LLC (see -m)\n"
+		 "  -Q, --saturate\n"
+		 "        PING_PONG on K pairs of cores at once, each pair on its own cache line, for K = 1 up to\n"
+		 "        all the pairs of physical cores: the pairs on the same package, then the pairs across\n"
+		 "        packages. Prints the aggregate transfers/s and the per-pair latency inflation for every K\n"
+		 "  -X, --threads\n"
+		 "        Run the roles as threads of one process, on anonymous memory, instead of as forked\n"
+		 "        processes that share the cache lines and the barriers through shm\n"
+		 "  -d, --server <path>\n"
+		 "        Keep the processes pinned and calibrated, and run the tests requested on the Unix socket\n"
+		 "        path, one line each: key=value pairs of event (number or name), core0, core1, core2,\n"
+		 "        reps (at most -r), fence, stride, and mem_size (at most -m). Every line gets a result\n"
+		 "        (or error) line back, \"quit\" stops the server\n"
+		 "  -b, --batch <file>\n"
+		 "        Like --server, with the request lines of file, and the result lines on the output\n"
+		 "  -I, --scenario <file>\n"
+		 "        Run the scenario of file instead of the test: one statement per line, \"phase\" starts\n"
+		 "        the next phase, \"<role> <primitive> [<store>]\" makes the ID role run the primitive\n"
+		 "        (store, load, cas, fai, tas, swap, clflush, lfence, sfence, mfence, pause, nop) on the\n"
+		 "        line, timed into the named sample store (at most " XSTR(PFD_NUM_STORES) "), \"advance\" takes a fresh line\n"
+		 "        on every repetition, \"name <text>\" names the scenario. #cores = the highest role + 1\n"
+		 "  -l, --plugin <file.so>\n"
+		 "        Load the events of a plugin (see include/ccbench_plugin.h), to be selected by name with -t.\n"
+		 "        Can be repeated. #cores = the roles of the event\n"
+		 "  -N, --mem-node <int>\n"
+		 "        Bind the shared cache lines and the measurement buffers to this NUMA node\n"
+		 "        (default=" XSTR(DEFAULT_MEM_NODE) ", i.e., first touch on the node of the core)\n"
 		 "  -u, --success\n"
 		 "        Make all atomic operations be successfull (e.g, TAS_ON_SHARED)\n"
 		 "  -v, --verbose\n"
 		 "        Verbose printing of results (default=" XSTR(DEFAULT_VERBOSE) ")\n"
 		 "  -p, --print <int>\n"
 		 "        If verbose, how many results to print (default=" XSTR(DEFAULT_PRINT) ")\n"
+		 "  -M, --matrix <int>\n"
+		 "        Measure the test on many core pairs in a single run and print a table with the median\n"
+		 "        and the avg of the measurement that characterizes the event (default=" XSTR(DEFAULT_MATRIX) ")\n"
+		 "        0 = single run / 1 = core2 iterates over all online cores / 2 = core1 and core2 iterate over\n"
+		 "        all online cores (N x N table)\n"
+		 "  -T, --topology <int>\n"
+		 "        Print the topology of the processor (default=" XSTR(DEFAULT_TOPOLOGY) ")\n"
+		 "        1 = print the sysfs topology and the distance class of every pair of cores / 2 = also measure\n"
+		 "        the LOAD_FROM_MODIFIED N x N matrix, cluster it into latency domains, and label every pair\n"
+		 "  -A, --sample <int>\n"
+		 "        With -M or -T 2: measure at most this many pairs per distance class and pair of packages\n"
+		 "        (0 = all), mirror the symmetric events (CAS, FAI, TAS, SWAP, CAS_CONCURRENT), and infer\n"
+		 "        the rest of the cells from the class medians. A table with the source of every cell is\n"
+		 "        printed\n"
+		 "        (default=" XSTR(DEFAULT_SAMPLE) ")\n"
+		 "  -J, --journal <file>\n"
+		 "        With -M, -T 2, or -S: append the settings, the pfd correction, and every completed cell\n"
+		 "        to file (key=value lines)\n"
+		 "  -R, --resume <file>\n"
+		 "        Continue the sweep of the journal file: the settings must match, the pfd correction is\n"
+		 "        re-validated, the completed cells are skipped, and the new ones are appended\n"
+		 "  -P, --parallel <int>\n"
+		 "        With -M, -T 2, or -S: measure up to this many cells concurrently, each on its own cores\n"
+		 "        (not SMT siblings of the others), cache lines, and barriers (default=" XSTR(DEFAULT_GROUPS) ")\n"
+		 "  -K, --check <int>\n"
+		 "        With -P > 1: re-measure this percentage of the cells serially and flag (*) the cells\n"
+		 "        that differ by more than " XSTR(CHECK_TOLERANCE) " of the serial value (default=" XSTR(DEFAULT_CHECK) ")\n"
+		 "  -E, --epoch <int>\n"
+		 "        Prepare this many lines (one stride apart) into the state of the test per round of\n"
+		 "        barriers, then measure all of them: every barrier round gives that many samples. Must\n"
+		 "        divide the repetitions (default=" XSTR(DEFAULT_EPOCH) ")\n"
+		 "  -g, --seed <int>\n"
+		 "        Seed of the random streams: every process draws from its own stream of the seed, so a\n"
+		 "        run with the same seed repeats the same accesses (default: from the clock, printed)\n"
+		 "  -G, --pattern <name>[:<int>]\n"
+		 "        The lines that the kernels access before the target line of a repetition, against the\n"
+		 "        prefetchers, generated before the run: none / random = random lines of the stride /\n"
+		 "        shuffle = distinct random lines of the stride; and how many (default=random:" XSTR(DEFAULT_DECOYS) ")\n"
+		 "  -V, --verify-kernels\n"
+		 "        Print the timed region (rdtsc to rdtsc) of every kernel in the binary, check that it has\n"
+		 "        exactly the instructions of the kernel, and exit (non-zero on a mismatch)\n"
 		 );
 	  printf("Supported events: \n");
-	  int ar;
+	  int ar, hidden = 0;
 	  for (ar = 0; ar < NUM_EVENTS; ar++)
 	    {
+	      if (test_missing(ar, test_fence))
+		{
+		  hidden++;
+		  continue;
+		}
 	      printf("      %2d - %s\n", ar, moesi_type_des[ar]);
 	    }
+	  if (hidden)
+	    {
+	      printf("      (%d events need instructions that this processor does not have)\n", hidden);
+	    }
 
 	  exit(0);
 	case 'c':
 	  test_cores = atoi(optarg);
+	  cores_set = 1;
 	  break;
 	case 'r':
 	  test_reps = atoi(optarg);
 	  break;
 	case 't':
-	  test_test = atoi(optarg);
+	  test_event = optarg;
 	  break;
 	case 'x':
 	  test_core1 = atoi(optarg);
@@ -210,6 +442,26 @@ main(int argc, char **argv)
 	case 'o':
 	  test_core_others = atoi(optarg);
 	  break;
+	case 'L':
+	  test_roles_num = parse_cpu_list(optarg, &test_roles);
+	  if (test_roles_num == 0)
+	    {
+	      printf("* error: invalid cpu list: %s\n", optarg);
+	      exit(1);
+	    }
+	  for (i = 1; i < test_roles_num; i++)
+	    {
+	      uint32_t j;
+	      for (j = 0; j < i; j++)
+		{
+		  if (test_roles[i] == test_roles[j])
+		    {
+		      printf("* error: cpu %u is twice in the cpu list %s\n", test_roles[i], optarg);
+		      exit(1);
+		    }
+		}
+	    }
+	  break;
 	case 'f':
 	  test_flush = 1;
 	  break;
@@ -233,6 +485,90 @@ main(int argc, char **argv)
 	  test_verbose = 1;
 	  test_print = atoi(optarg);
 	  break;
+	case 'M':
+	  test_matrix = atoi(optarg);
+	  break;
+	case 'T':
+	  test_topology = atoi(optarg);
+	  break;
+	case 'N':
+	  test_mem_node = atoi(optarg);
+	  break;
+	case 'S':
+	  test_sweep3 = 1;
+	  test_cores = 3;
+	  break;
+	case 'C':
+	  test_characterize = 1;
+	  test_cores = 3;
+	  break;
+	case 'H':
+	  test_smt = atoi(optarg);
+	  test_characterize = (test_smt > 0);
+	  test_cores = 3;
+	  break;
+	case 'W':
+	  test_home = 1;
+	  test_cores = 3;
+	  break;
+	case 'D':
+	  test_dram = 1;
+	  test_cores = 1;
+	  break;
+	case 'Q':
+	  test_saturate = 1;
+	  test_cores = 2;
+	  break;
+	case 'X':
+	  test_threads = 1;
+	  break;
+	case 'd':
+	  test_server = optarg;
+	  test_cores = 3;
+	  break;
+	case 'b':
+	  test_batch = optarg;
+	  test_cores = 3;
+	  break;
+	case 'I':
+	  test_scenario = optarg;
+	  break;
+	case 'l':
+	  plugin_load(optarg);
+	  break;
+	case 'P':
+	  test_groups = atoi(optarg);
+	  break;
+	case 'K':
+	  test_check = atoi(optarg);
+	  break;
+	case 'A':
+	  test_sample = atoi(optarg);
+	  break;
+	case 'J':
+	  test_journal = optarg;
+	  break;
+	case 'R':
+	  test_journal = optarg;
+	  test_resume = 1;
+	  break;
+	case 'V':
+	  exit(verify_kernels());
+	case 'E':
+	  test_epoch = atoi(optarg);
+	  break;
+	case 'g':
+	  test_seed = strtoull(optarg, NULL, 0);
+	  test_seed_set = 1;
+	  break;
+	case 'G':
+	  if (pattern_parse(optarg) < 0)
+	    {
+	      printf("* error: --pattern %s: expected none, random[:<decoys>], or shuffle[:<decoys>]\n", 
+		     optarg);
+	      exit(1);
+	    }
+	  break;
 	case '?':
 	  printf("Use -h or --help for help\n");
 	  exit(0);
@@ -242,1732 +578,3878 @@ main(int argc, char **argv)
     }
 
 
-  test_cache_line_num = test_mem_size / sizeof(cache_line_t);
-
-  if ((test_test == STORE_ON_EXCLUSIVE || test_test == STORE_ON_INVALID || test_test == LOAD_FROM_INVALID
-       || test_test == LOAD_FROM_EXCLUSIVE || test_test == LOAD_FROM_SHARED) && !test_flush)
+  if (test_event != NULL)
     {
-      assert((test_reps * test_stride) <= test_cache_line_num);
+      int32_t e = event_parse(test_event);
+      if (e < 0)
+	{
+	  e = plugin_event(test_event);
+	}
+      if (e < 0)
+	{
+	  printf("* error: unknown event %s (see -h, or load its plugin with -l)\n", test_event);
+	  exit(1);
+	}
+      test_test = e;
     }
-
-  if (test_test != LOAD_FROM_MEM_SIZE)
+  if (test_test >= NUM_EVENTS)
     {
-      assert(test_stride < test_cache_line_num);
+      test_plugin = &plugin_events[test_test - NUM_EVENTS];
+      plugin_scenario(test_plugin, &plugin_scen);
+      if (!cores_set)
+	{
+	  test_cores = test_plugin->roles;
+	}
+      else if (test_cores < test_plugin->roles)
+	{
+	  printf("* error: %s has %u roles, but -c is %u\n", test_plugin->name, test_plugin->roles, 
+		 test_cores);
+	  exit(1);
+	}
     }
 
-
-  ID = 0;
-  printf("test: %20s  / #cores: %d / #repetitions: %d / stride: %d (%u kiB)", moesi_type_des[test_test], 
-	 test_cores, test_reps, test_stride, (64 * test_stride) / 1024);
-  if (test_flush)
+  /* the modes that place the cores themselves */
+  if (test_dram)
     {
-      printf(" / flush");
+      test_test = LOAD_FROM_MEM_SIZE;
     }
-
-  printf("  / fence: ");
-
-  switch (test_fence)
+  if (test_saturate)
     {
-    case 1:
-      printf(" load & store");
-      test_lfence = test_sfence = 1;
-      break;
-    case 2:
-      printf(" full");
-      test_lfence = test_sfence = 2;
-      break;
-    case 3:
-      printf(" load");
-      test_lfence = 1;
-      test_sfence = 0;
-      break;
-    case 4:
-      printf(" store");
-      test_lfence = 0;
-      test_sfence = 1;
-      break;
-    case 5:
-      printf(" full/none");
-      test_lfence = 2;
-      test_sfence = 0;
-      break;
-    case 6:
-      printf(" none/full");
-      test_lfence = 0;
-      test_sfence = 2;
-      break;
-    case 7:
-      printf(" full/store");
-      test_lfence = 2;
-      test_sfence = 1;
-      break;
-    case 8:
-      printf(" load/full");
-      test_lfence = 1;
-      test_sfence = 2;
-      break;    
-    case 9:
-      printf(" double write");
-      test_lfence = 0;
-      test_sfence = 3;
-      break;
-    default:
-      printf(" none");
-      test_lfence = test_sfence = 0;
-      break;
+      test_test = PING_PONG;
     }
-
-  printf("\n");
-
-  printf("core1: %3u / core2: %3u ", test_core1, test_core2);
-  if (test_cores >= 3)
+  if (test_test == PING_PONG && test_cores < 2)
     {
-      printf("/ core3: %3u", test_core3);
+      printf("* error: PING_PONG needs 2 cores (-c 2)\n");
+      exit(1);
     }
-  printf("\n");
-
-  barriers_init(test_cores);
-  seeds = seed_rand();
-
-  volatile cache_line_t* cache_line = cache_line_open();
-
-  int rank;
-  for (rank = 1; rank < test_cores; rank++) 
+  if (test_server && test_batch)
     {
-      pid_t child = fork();
-      if (child < 0) 
+      printf("* error: --server and --batch cannot be used together\n");
+      exit(1);
+    }
+  if (test_batch && access(test_batch, R_OK) < 0)
+    {
+      printf("* error: cannot read the batch file %s: %s\n", test_batch, strerror(errno));
+      exit(1);
+    }
+  int serving = (test_server != NULL || test_batch != NULL);
+  if (test_scenario != NULL)
+    {
+      char err[SERVER_LINE];
+      uint32_t roles = script_load(test_scenario, err, sizeof(err));
+      if (roles == 0)
 	{
-	  P("Failure in fork():\n%s", strerror(errno));
-	} 
-      else if (child == 0) 
+	  printf("* error: --scenario: %s\n", err);
+	  exit(1);
+	}
+      if (cell_mode() || test_topology)
+	{
+	  printf("* error: --scenario runs a single test: no sweeps, matrices, or servers\n");
+	  exit(1);
+	}
+      test_plugin = NULL;
+      if (!cores_set)
+	{
+	  test_cores = roles;
+	}
+      else if (test_cores < roles)
 	{
-	  goto fork_done;
+	  printf("* error: the scenario has %u roles, but -c is %u\n", roles, test_cores);
+	  exit(1);
 	}
     }
-  rank = 0;
+  if (test_plugin != NULL && (cell_mode() || test_topology))
+    {
+      printf("* error: the events of plugins run as a single test: no sweeps, matrices, or servers\n");
+      exit(1);
+    }
+  uint32_t missing = test_missing(test_test, test_fence);
+  if (missing && !test_characterize && !test_sweep3 && !serving)
+    {
+      char feats[256];
+      cpu_features_str(missing, feats, sizeof(feats));
+      printf("* error: %s needs %s, which this processor does not have\n", 
+	     test_scenario != NULL ? test_script_name : moesi_type_des[test_test], feats);
+      exit(1);
+    }
+  int placed = test_sweep3 || test_characterize || test_home || test_dram || test_saturate || serving;
 
- fork_done:
-  ID = rank;
-  size_t core = 0;
-  switch (ID)
+  if (test_epoch == 0 || test_reps % test_epoch)
     {
-    case 0:
-      core = test_core1;
-      break;
-    case 1:
-      core = test_core2;
-      break;
-    case 2:
-      core = test_core3;
-      break;
-    default:
-      core = ID - test_core_others;
+      printf("* error: --epoch %u must divide the %u repetitions\n", test_epoch, test_reps);
+      exit(1);
+    }
+  if (test_epoch > 1 && test_test == LOAD_FROM_MEM_SIZE)
+    {
+      printf("* error: --epoch does not apply to LOAD_FROM_MEM_SIZE: the chase already walks many lines\n");
+      exit(1);
     }
 
-#if defined(NIAGARA)
-  if (test_cores <= 8 && test_cores > 3)
+  if (test_roles != NULL)
     {
-      if (ID == 0)
+      if (!cores_set && !placed)
+	{
+	  test_cores = test_roles_num;
+	}
+      if (test_cores > test_roles_num)
 	{
-	  PRINT(" ** spreading the 8 threads on the 8 real cores");
+	  printf("* error: %u cores but only %u cpus in --cpus\n", test_cores, test_roles_num);
+	  exit(1);
 	}
-      core = ID * 8;
+      test_core1 = test_roles[0];
+      test_core2 = (test_roles_num > 1) ? test_roles[1] : test_core2;
+      test_core3 = (test_roles_num > 2) ? test_roles[2] : test_core3;
     }
-#endif
-
-  set_cpu(core);
 
-#if defined(__tile__)
-  tmc_cmem_init(0);		/*   initialize shared memory */
-#endif  /* TILERA */
-
-  volatile uint64_t* cl = (volatile uint64_t*) cache_line;
-
-  B0;
-  if (ID < 3)
+  /* the cores that we place IDs on, directly, must be in our affinity mask. The matrix modes */
+  /* iterate over the mask (except for core1 with -M 1) */
+  uint32_t role;
+  cell_t fixed = { test_test, { test_core1, test_core2, test_core3 }, 0, -1, -1 };
+  int all_pairs = (test_matrix >= 2 || test_topology >= 2) && !test_sweep3 && !test_characterize;
+  if (!all_pairs && !test_home && !test_dram && !test_saturate && !serving)
     {
-      PFDINIT(test_reps);
+      check_core(test_core1, "core1");
+    }
+  if (test_cores > 1 && !test_matrix && !test_topology && !placed)
+    {
+      check_core(test_core2, "core2");
+    }
+  if (test_cores > 2 && !placed)
+    {
+      check_core(test_core3, "core3");
+    }
+  for (role = 3; role < test_cores; role++)
+    {
+      check_core(role_core(role, &fixed), "an ID > 2");
     }
-  B0;
 
-  /* /\********************************************************************************* */
-  /*  *  main functionality */
-  /*  *********************************************************************************\/ */
+  if (!topo_init(test_cpus, test_cpus_num) && test_topology)
+    {
+      printf("* warning: could not read the topology from " TOPO_SYSFS_CPU "\n");
+    }
 
-  uint64_t sum = 0;
+  if (test_mem_node >= 0 && !topo_node_valid(test_mem_node))
+    {
+      printf("* error: memory node %d does not exist (%u nodes)\n", test_mem_node, topo_num_nodes());
+      exit(1);
+    }
 
-  volatile uint64_t reps;
-  for (reps = 0; reps < test_reps; reps++)
+  if (test_topology)
     {
-      if (test_flush)
+      cpu_print();
+      topo_print();
+      if (test_topology == 1)
 	{
-	  _mm_mfence();
-	  _mm_clflush((void*) cache_line);
-	  _mm_mfence();
+	  exit(0);
 	}
+      test_test = LOAD_FROM_MODIFIED;
+      test_matrix = 2;
+    }
 
-      B0;			/* BARRIER 0 */
-
-      switch (test_test)
-	{
-	case STORE_ON_MODIFIED: /* 0 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		store_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case STORE_ON_MODIFIED_NO_SYNC: /* 1 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-	      case 1:
-	      case 2:
-		store_0(cache_line, reps);
-		break;
-	      default:
-		store_0_no_pf(cache_line, reps);
-		break;
-	      }
-	    break;
-	  }
-	case STORE_ON_EXCLUSIVE: /* 2 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		store_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-
-	    if (!test_flush)
-	      {
-		cache_line += test_stride;
-	      }
-	    break;
-	  }
-	case STORE_ON_SHARED:	/* 3 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		store_0_eventually(cache_line, reps);
-		break;
-	      case 2:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;			/* BARRIER 2 */
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case STORE_ON_OWNED_MINE: /* 4 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;			/* BARRIER 2 */
-		break;
-	      case 1:
-		store_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		store_0_eventually_pfd1(cache_line, reps);
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case STORE_ON_OWNED:	/* 5 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;			/* BARRIER 2 */
-		store_0_eventually_pfd1(cache_line, reps);
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case STORE_ON_INVALID:	/* 6 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		B1;
-		/* store_0_eventually(cache_line, reps); */
-		store_0(cache_line, reps);
-		if (!test_flush)
-		  {
-		    cache_line += test_stride;
-		  }
-		break;
-	      case 1:
-		invalidate(cache_line, 0, reps);
-		if (!test_flush)
-		  {
-		    cache_line += test_stride;
-		  }
-		B1;
-		break;
-	      default:
-		B1;
-		break;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_MODIFIED: /* 7 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;		
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;
-		break;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_EXCLUSIVE: /* 8 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-
-		if (!test_flush)
-		  {
-		    cache_line += test_stride;
-		  }
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-
-		if (!test_flush)
-		  {
-		    cache_line += test_stride;
-		  }
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_SHARED:	/* 9 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;			/* BARRIER 2 */
-		break;
-	      case 2:
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		sum += load_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-
-	    if (!test_flush)
-	      {
-		cache_line += test_stride;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_OWNED:	/* 10 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;			/* BARRIER 2 */
-		break;
-	      case 2:
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		sum += load_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_INVALID:	/* 11 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		B1;			/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps); 		/* sum += load_0(cache_line, reps); */
-		break;
-	      case 1:
-		invalidate(cache_line, 0, reps);
-		B1;			/* BARRIER 1 */
-		break;
-	      default:
-		B1;			/* BARRIER 1 */
-		break;
-	      }
-
-	    if (!test_flush)
-	      {
-		cache_line += test_stride;
-	      }
-	    break;
-	  }
-	case CAS: /* 12 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += cas_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += cas_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case FAI: /* 13 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += fai(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += fai(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case TAS:		/* 14 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += tas(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += tas(cache_line, reps);
-		_mm_mfence();
-		cache_line->word[0] = 0;
-		B2;		/* BARRIER 2 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case SWAP: /* 15 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += swap(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += swap(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case CAS_ON_MODIFIED: /* 16 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		if (test_ao_success)
-		  {
-		    cache_line->word[0] = reps & 0x01;
-		  }
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += cas_0_eventually(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case FAI_ON_MODIFIED: /* 17 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += fai(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case TAS_ON_MODIFIED: /* 18 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		if (!test_ao_success)
-		  {
-		    cache_line->word[0] = 0xFFFFFFFF;
-		    _mm_mfence();
-		  }
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += tas(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case SWAP_ON_MODIFIED: /* 19 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		store_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		sum += swap(cache_line, reps);
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-	    break;
-	  }
-	case CAS_ON_SHARED: /* 20 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		sum += cas_0_eventually(cache_line, reps);
-		break;
-	      case 2:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;		/* BARRIER 2 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case FAI_ON_SHARED: /* 21 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		sum += fai(cache_line, reps);
-		break;
-	      case 2:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;		/* BARRIER 2 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case TAS_ON_SHARED: /* 22 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		if (test_ao_success)
-		  {
-		    cache_line->word[0] = 0;
-		  }
-		else
-		  {
-		    cache_line->word[0] = 0xFFFFFFFF;
-		  }
-		sum += load_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		sum += tas(cache_line, reps);
-		break;
-	      case 2:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;		/* BARRIER 2 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case SWAP_ON_SHARED: /* 23 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		sum += load_0_eventually(cache_line, reps);
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		break;
-	      case 1:
-		B1;		/* BARRIER 1 */
-		B2;		/* BARRIER 2 */
-		sum += swap(cache_line, reps);
-		break;
-	      case 2:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually(cache_line, reps);
-		B2;		/* BARRIER 2 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		sum += load_0_eventually_no_pf(cache_line);
-		B2;			/* BARRIER 2 */
-		break;
-	      }
-	    break;
-	  }
-	case CAS_CONCURRENT: /* 24 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-	      case 1:
-		sum += cas(cache_line, reps);
-		break;
-	      default:
-		sum += cas_no_pf(cache_line, reps);
-		break;
-	      }
-	    break;
-	  }
-	case FAI_ON_INVALID:	/* 25 */
-	  {
-	    switch (ID)
-	      {
-	      case 0:
-		B1;		/* BARRIER 1 */
-		sum += fai(cache_line, reps);
-		break;
-	      case 1:
-		invalidate(cache_line, 0, reps);
-		B1;		/* BARRIER 1 */
-		break;
-	      default:
-		B1;		/* BARRIER 1 */
-		break;
-	      }
-
-	    if (!test_flush)
-	      {
-		cache_line += test_stride;
-	      }
-	    break;
-	  }
-	case LOAD_FROM_L1:	/* 26 */
-	  {
-	    if (ID == 0)
-	      {
-		sum += load_0(cache_line, reps);
-		sum += load_0(cache_line, reps);
-		sum += load_0(cache_line, reps);
-	      }
-	    break;
-	  }
-	case LOAD_FROM_MEM_SIZE: /* 27 */
-	  {
-	    if (ID < 3)
-	      {
-		sum += load_next(cl, reps);
-	      }
-	  }
-	  break;
-	case LFENCE:		/* 28 */
-	  if (ID < 2)
-	    {
-	      PFDI(0);
-	      _mm_lfence();
-	      PFDO(0, reps);
-	    }
-	  break;
-	case SFENCE:		/* 29 */
-	  if (ID < 2)
-	    {
-	      PFDI(0);
-	      _mm_sfence();
-	      PFDO(0, reps);
-	    }
-	  break;
-	case MFENCE:		/* 30 */
-	  if (ID < 2)
-	    {
-	      PFDI(0);
-	      _mm_mfence();
-	      PFDO(0, reps);
-	    }
-	  break;
-	case PAUSE:		/* 31 */
-	  if (ID < 2)
-	    {
-	      PFDI(0);
-	      _mm_pause();
-	      PFDO(0, reps);
-	    }
-	  break;
-	case NOP:		/* 32 */
-	  if (ID < 2)
-	    {
-	      PFDI(0);
-	      asm volatile ("nop");
-	      PFDO(0, reps);
-	    }
-	  break;
-	case PROFILER:		/* 30 */
-	default:
-	  PFDI(0);
-	  asm volatile ("");
-	  PFDO(0, reps);
-	  break;
-	}
+  test_cache_line_num = test_mem_size / sizeof(cache_line_t);
 
-      B3;			/* BARRIER 3 */
+  if (test_home && (test_test == LOAD_FROM_MEM_SIZE || event_procs(test_test) < 2))
+    {
+      printf("* error: --home needs an event with an owner and a requester of the line\n");
+      exit(1);
     }
 
-  if (!test_verbose)
+  if (test_groups == 0)
     {
-      test_print = 0;
+      test_groups = 1;
     }
-
-  uint32_t id;
-  for (id = 0; id < test_cores; id++)
+  if (test_saturate)
     {
-      if (ID == id && ID < 3)
+      /* one group per pair: K pairs at once use groups 0..K-1 */
+      uint32_t intra = saturate_pairs(0, NULL, NULL), cross = saturate_pairs(1, NULL, NULL);
+      test_groups = (intra > cross) ? intra : cross;
+      if (test_groups == 0)
 	{
-	  switch (test_test)
-	    {
-	    case STORE_ON_OWNED_MINE:
-	    case STORE_ON_OWNED:
-	      if (ID < 2)
-		{
-		  PRINT(" *** Core %2d ************************************************************************************", ID);
-		  PFDPN(0, test_reps, test_print);
-		  if (ID == 1)
-		    {
-		      PFDPN(1, test_reps, test_print);
-		    }
-		}
-	      break;
-	    case CAS_CONCURRENT:
-	      if (ID < 2)
-		{
-		  PRINT(" *** Core %2d ************************************************************************************", ID);
-		  PFDPN(0, test_reps, test_print);
-		}
-	      break;
-	    case LOAD_FROM_L1:
-	      if (ID < 1)
-		{
-		  PRINT(" *** Core %2d ************************************************************************************", ID);
-		  PFDPN(0, test_reps, test_print);
-		}
-	      break;
-	    case LOAD_FROM_MEM_SIZE:
-	      if (ID < 3)
-		{
-		  PRINT(" *** Core %2d ************************************************************************************", ID);
-		  PFDPN(0, test_reps, test_print);
-		}
-	      break;
-	    default:
-	      PRINT(" *** Core %2d ************************************************************************************", ID);
-	      PFDPN(0, test_reps, test_print);
-	    }
+	  printf("* error: --saturate needs at least two physical cores\n");
+	  exit(1);
 	}
-      B0;
     }
-  B10;
-
-
-  if (ID == 0)
+  if (test_groups > 1 && !test_saturate)
     {
-      switch (test_test)
-	{
-	case STORE_ON_MODIFIED:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : store on invalid");
-		PRINT(" ** Results from Core 1 : store on modified");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 and 1 : store on modified");
-	      }
-	    break;
-	  }
-	case STORE_ON_MODIFIED_NO_SYNC:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results do not make sense");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 and 1 : store on modified while another core is "
-		      "also trying to do the same");
-	      }
-	    break;
-	  }
-	case STORE_ON_EXCLUSIVE:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid, BUT could have prefetching");
-	      }
-	    PRINT(" ** Results from Core 1 : store on exclusive");
-	    break;
-	  }
-	case STORE_ON_SHARED:
-	  {
-	    PRINT(" ** Results from Core 0 & 2: load from modified and exclusive or shared, respectively");
-	    PRINT(" ** Results from Core 1 : store on shared");
-	    if (test_cores < 3)
-	      {
-		PRINT(" ** Need >=3 processes to achieve STORE_ON_SHARED");
-	      }
-	    break;
-	  }
-	case STORE_ON_OWNED_MINE:
-	  {
-	    PRINT(" ** Results from Core 0 : load from modified (makes it owned, if owned state is supported)");
-	    if (test_flush)
-	      {
-		PRINT(" ** Results 1 from Core 1 : store to invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results 1 from Core 1 : store to modified mine");
-	      }
-
-	    PRINT(" ** Results 2 from Core 1 : store to owned mine (if owned is supported, else exclusive)");
-	    break;
-	  }
-	case STORE_ON_OWNED:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : store to modified");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : store to invalid");
-	      }
-	    PRINT(" ** Results 1 from Core 1 : load from modified (makes it owned, if owned state is supported)");
-	    PRINT(" ** Results 2 from Core 1 : store to owned (if owned is supported, else exclusive mine)");
-	    break;
-	  }
-	case LOAD_FROM_MODIFIED:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : store to invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : store to owned mine (if owned state supported, else exclusive)");
-	      }
-
-	    PRINT(" ** Results from Core 1 : load from modified (makes it owned, if owned state supported)");
-
-	    break;
-	  }
-	case LOAD_FROM_EXCLUSIVE:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid, BUT could have prefetching");
-	      }
-	    PRINT(" ** Results from Core 1 : load from exclusive");
-
-	    break;
-	  }
-	case STORE_ON_INVALID:
-	  {
-	    PRINT(" ** Results from Core 0 : store on invalid");
-	    PRINT(" ** Results from Core 1 : cache line flush");
-	    break;
-	  }
-	case LOAD_FROM_INVALID:
-	  {
-	    PRINT(" ** Results from Core 0 : load from invalid");
-	    PRINT(" ** Results from Core 1 : cache line flush");
-	    break;
-	  }
-	case LOAD_FROM_SHARED:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : load from invalid, BUT could have prefetching");
-	      }
-	    PRINT(" ** Results from Core 1 : load from exclusive");
-	    if (test_cores >= 3)
-	      {
-		PRINT(" ** Results from Core 2 : load from shared");
-	      }
-	    else
-	      {
-		PRINT(" ** Need >=3 processes to achieve LOAD_FROM_SHARED");
-	      }
-	    break;
-	  }
-	case LOAD_FROM_OWNED:
-	  {
-	    if (test_flush)
-	      {
-		PRINT(" ** Results from Core 0 : store to invalid");
-	      }
-	    else
-	      {
-		PRINT(" ** Results from Core 0 : store to owned mine (if owned is supported, else shared)");
-	      }
-	    PRINT(" ** Results from Core 1 : load from modified");
-	    if (test_cores == 3)
-	      {
-		PRINT(" ** Results from Core 2 : load from owned");
-	      }
-	    else
-	      {
-		PRINT(" ** Need 3 processes to achieve LOAD_FROM_OWNED");
-	      }
-	    break;
-	  }
-	case CAS:
-	  {
-	    PRINT(" ** Results from Core 0 : CAS successfull");
-	    PRINT(" ** Results from Core 1 : CAS unsuccessfull");
-	    break;
-	  }
-	case FAI:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: FAI");
-	    break;
-	  }
-	case TAS:
-	  {
-	    PRINT(" ** Results from Core 0 : TAS successfull");
-	    PRINT(" ** Results from Core 1 : TAS unsuccessfull");
-	    break;
-	  }
-	case SWAP:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: SWAP");
-	    break;
-	  }
-	case CAS_ON_MODIFIED:
-	  {
-	    PRINT(" ** Results from Core 0 : store on modified");
-	    uint32_t succ = 50 + test_ao_success * 50;
-	    PRINT(" ** Results from Core 1 : CAS on modified (%d%% successfull)", succ);
-	    break;
-	  }
-	case FAI_ON_MODIFIED:
-	  {
-	    PRINT(" ** Results from Core 0 : store on modified");
-	    PRINT(" ** Results from Core 1 : FAI on modified");
-	    break;
-	  }
-	case TAS_ON_MODIFIED:
-	  {
-	    PRINT(" ** Results from Core 0 : store on modified");
-	    uint32_t succ = test_ao_success * 100;
-	    PRINT(" ** Results from Core 1 : TAS on modified (%d%% successfull)", succ);
-	    break;
-	  }
-	case SWAP_ON_MODIFIED:
-	  {
-	    PRINT(" ** Results from Core 0 : store on modified");
-	    PRINT(" ** Results from Core 1 : SWAP on modified");
-	    break;
-	  }
-	case CAS_ON_SHARED:
-	  {
-	    PRINT(" ** Results from Core 0 : load from modified");
-	    PRINT(" ** Results from Core 1 : CAS on shared (100%% successfull)");
-	    PRINT(" ** Results from Core 2 : load from exlusive or shared");
-	    if (test_cores < 3)
-	      {
-		PRINT(" ** Need >=3 processes to achieve CAS_ON_SHARED");
-	      }
-	    break;
-	  }
-	case FAI_ON_SHARED:
-	  {
-	    PRINT(" ** Results from Core 0 : load from modified");
-	    PRINT(" ** Results from Core 1 : FAI on shared");
-	    PRINT(" ** Results from Core 2 : load from exlusive or shared");
-	    if (test_cores < 3)
-	      {
-		PRINT(" ** Need >=3 processes to achieve FAI_ON_SHARED");
-	      }
-	    break;
-	  }
-	case TAS_ON_SHARED:
-	  {
-	    PRINT(" ** Results from Core 0 : load from L1");
-	    uint32_t succ = test_ao_success * 100;
-	    PRINT(" ** Results from Core 1 : TAS on shared (%d%% successfull)", succ);
-	    PRINT(" ** Results from Core 2 : load from exlusive or shared");
-	    if (test_cores < 3)
-	      {
-		PRINT(" ** Need >=3 processes to achieve TAS_ON_SHARED");
-	      }
-	    break;
-	  }
-	case SWAP_ON_SHARED:
-	  {
-	    PRINT(" ** Results from Core 0 : load from modified");
-	    PRINT(" ** Results from Core 1 : SWAP on shared");
-	    PRINT(" ** Results from Core 2 : load from exlusive or shared");
-	    if (test_cores < 3)
-	      {
-		PRINT(" ** Need >=3 processes to achieve SWAP_ON_SHARED");
-	      }
-	    break;
-	  }
-	case CAS_CONCURRENT:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: CAS concurrent");
-	    break;
-	  }
-	case FAI_ON_INVALID:
-	  {
-	    PRINT(" ** Results from Core 0 : FAI on invalid");
-	    PRINT(" ** Results from Core 1 : cache line flush");
-	    break;
-	  }
-	case LOAD_FROM_L1:
-	  {
-	    PRINT(" ** Results from Core 0: load from L1");
-	    break;
-	  }
-	case LOAD_FROM_MEM_SIZE:
-	  {
-	    PRINT(" ** Results from Corees 0 & 1 & 2: load from random %zu KiB", test_mem_size / 1024);
-	    break;
-	  }
-	case LFENCE:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: load fence");
-	    break;
-	  }
-	case SFENCE:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: store fence");
-	    break;
-	  }
-	case MFENCE:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: full fence");
-	    break;
-	  }
-	case PROFILER:
-	  {
-	    PRINT(" ** Results from Cores 0 & 1: empty profiler region (start_prof - empty - stop_prof");
-	    break;
-	  }
-
-	default:
-	  break;
+      uint32_t max_groups = test_cpus_num / test_cores;
+      if (!cell_mode())
+	{
+	  printf("* warning: -P is used only with -M, -T 2, -S, -C, -H, -W, -D, or -Q\n");
+	  test_groups = 1;
+	}
+      else if (test_test == LOAD_FROM_MEM_SIZE && !placed)
+	{
+	  printf("* warning: the groups of -P would share the memory of LOAD_FROM_MEM_SIZE, running serially\n");
+	  test_groups = 1;
+	}
+      else if (test_dram)
+	{
+	  printf("* warning: the groups of -P would load the memory of --dram, running serially\n");
+	  test_groups = 1;
+	}
+      else if (test_groups > max_groups)
+	{
+	  printf("* warning: %u cores fit at most %u groups of %u processes\n", 
+		 test_cpus_num, max_groups, test_cores);
+	  test_groups = (max_groups > 0) ? max_groups : 1;
 	}
     }
+  if (test_home || test_dram)
+    {
+      uint32_t n;
+      test_home_slots = 0;
+      for (n = 0; n < topo_num_nodes(); n++)
+	{
+	  test_home_slots += topo_node_valid(n);
+	}
+      test_home_slots = (test_home_slots > 0) ? test_home_slots : 1;
+    }
+  test_group_lines = test_cache_line_num / (test_groups * test_home_slots);
+  if (test_home_slots > 1)
+    {
+      /* the cache lines of every node start on a page, so that they can be bound */
+      uint32_t page_lines = sysconf(_SC_PAGESIZE) / sizeof(cache_line_t);
+      test_group_lines -= test_group_lines % page_lines;
+    }
 
-  B0;
-
-
-  if (ID < 3)
+  if (!placed && test_epoch > 1 && !test_fits(test_test))
     {
-      PRINT(" value of cl is %-10u / sum is %llu", cache_line->word[0], (LLU) sum);
+      printf("* error: --epoch %u with stride %u needs more than the %u cache lines (use -m)\n", 
+	     test_epoch, test_stride, test_group_lines);
+      exit(1);
+    }
+  if (!placed && !test_fits(test_test))
+    {
+      assert((test_reps * test_stride) <= test_cache_line_num);
     }
-  cache_line_close(ID, "cache_line");
-  barriers_term(ID);
-  return 0;
 
-}
+  if (test_test != LOAD_FROM_MEM_SIZE)
+    {
+      assert(test_stride < test_group_lines);
+    }
 
-uint32_t
-cas(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  uint8_t o = reps & 0x1;
-  uint8_t no = !o; 
-  volatile uint32_t r;
+  if (test_stride >= 2 && decoys_fit(test_stride) < test_decoys)
+    {
+      printf("* warning: --pattern shuffle:%u needs distinct lines, only %u in the stride\n", 
+	     test_decoys, test_stride - 1);
+    }
+  if (!test_seed_set && test_resume && journal_seed(test_journal, &test_seed))
+    {
+      test_seed_set = 1;	/* the sample of the journal is drawn again */
+    }
+  if (!test_seed_set)
+    {
+      test_seed = getticks();	/* printed, so that the run can be repeated with --seed */
+    }
 
-  PFDI(0);
-  r = CAS_U32(cl->word, o, no);
-  PFDO(0, reps);
 
-  return (r == o);
+  ID = 0;
+  printf("test: %20s  / #cores: %d / #repetitions: %d / stride: %d (%u kiB)", 
+	 test_scenario ? test_script_name : test_plugin ? test_plugin->name : moesi_type_des[test_test], 
+	 test_cores, test_reps, test_stride, (64 * test_stride) / 1024);
+  if (test_flush)
+    {
+      printf(" / flush");
+    }
+
+  printf("  / fence:  %s", fence_set(test_fence));
+
+  if (test_mem_node >= 0)
+    {
+      printf(" / mem node: %d", test_mem_node);
+    }
+  if (test_groups > 1)
+    {
+      printf(" / parallel: %u", test_groups);
+    }
+  if (test_epoch > 1)
+    {
+      printf(" / epoch: %u", test_epoch);
+    }
+  printf(" / seed: %llu", (LLU) test_seed);
+  if (test_pattern != DEFAULT_PATTERN || test_decoys != DEFAULT_DECOYS)
+    {
+      printf(" / pattern: %s:%u", access_pattern_des[test_pattern], test_decoys);
+    }
+  printf("\n");
+
+  if (test_sweep3)
+    {
+      printf("requester: %3u / owner, sharer: one core per distance class ", test_core1);
+    }
+  else if (test_characterize)
+    {
+      printf("measuring core: %3u / others: one core per distance class ", test_core1);
+    }
+  else if (test_home)
+    {
+      printf("owner: all nodes / home: all nodes / requester: all nodes (%u) ", test_home_slots);
+    }
+  else if (test_dram)
+    {
+      printf("core: all (%u cores) / memory: all nodes (%u), %zu KiB each ", test_cpus_num, test_home_slots,
+	     (test_group_lines * sizeof(cache_line_t)) / 1024);
+    }
+  else if (test_saturate)
+    {
+      printf("pairs: 1 to %u at once, on the same package and across packages ", test_groups);
+    }
+  else if (test_server)
+    {
+      printf("cores: per request / listening on %s ", test_server);
+    }
+  else if (test_batch)
+    {
+      printf("cores: per line of %s ", test_batch);
+    }
+  else if (test_matrix == 1)
+    {
+      printf("core1: %3u / core2: all (%u cores) ", test_core1, test_cpus_num);
+    }
+  else if (test_matrix)
+    {
+      printf("core1: all / core2: all (%u cores) ", test_cpus_num);
+    }
+  else
+    {
+      printf("core1: %3u / core2: %3u ", test_core1, test_core2);
+    }
+  if (test_cores >= 3 && !placed)
+    {
+      printf("/ core3: %3u", test_core3);
+    }
+  printf("\n");
+  if (test_verbose)
+    {
+      cpu_print();
+    }
+
+  seeds = seed_rand(test_seed, 0);
+
+  cell_t* cells = NULL;
+  cell_res_t* cells_res = NULL;
+  uint32_t cells_num = 0, matrix_rows = 0;
+  cell_t* matrix = NULL;	/* with --sample, cells are only a subset of the matrix */
+  uint32_t* sample_of = NULL;
+  char_col_t char_cols[CHAR_COLS_MAX];
+  uint32_t char_cols_num = 0;
+  int32_t home_nodes[test_home_slots];
+  uint32_t sat_pairs[2] = { 0, 0 };
+  if (test_sweep3)
+    {
+      cells_num = sweep3_cells(&cells);
+    }
+  else if (test_home)
+    {
+      cells_num = home_cells(&cells, home_nodes);
+    }
+  else if (test_dram)
+    {
+      cells_num = dram_cells(&cells, home_nodes);
+    }
+  else if (test_saturate)
+    {
+      cells_num = saturate_cells(&cells, sat_pairs);
+    }
+  else if (test_characterize)
+    {
+      char_cols_num = test_smt ? smt_cols(char_cols) : characterize_cols(char_cols);
+      cells_num = characterize_cells(&cells, char_cols, char_cols_num);
+    }
+  else if (test_matrix)
+    {
+      matrix_rows = matrix_cells(&matrix);
+      cells = matrix;
+      cells_num = matrix_rows * test_cpus_num;
+      if (test_sample)
+	{
+	  cells_num = sample_cells(matrix, cells_num, &cells, &sample_of);
+	  printf("sampled %u of %u cells (at most %u per class and pair of packages)\n", 
+		 cells_num, matrix_rows * test_cpus_num, test_sample);
+	}
+    }
+  if (test_journal != NULL && !cells_num)
+    {
+      printf("* warning: -J and -R are used only with -M, -T 2, -S, -C, -H, -W, -D, or -Q\n");
+      test_journal = NULL;
+    }
+
+  schedule_t sched = { 0, NULL, NULL };
+  uint32_t* check_of = NULL;
+  uint32_t check_num = 0;
+  cell_res_t* resumed = NULL;
+  double resumed_correction = 0;
+  if (test_resume && test_journal != NULL)
+    {
+      resumed = (cell_res_t*) calloc(cells_num, sizeof(cell_res_t));
+      assert(resumed != NULL);
+      uint32_t n = journal_resume(test_journal, cells, cells_num, resumed, &resumed_correction);
+      printf("resuming from %s: %u of %u cells done\n", test_journal, n, cells_num);
+    }
+  if (cells_num)
+    {
+      if (test_saturate)
+	{
+	  /* the interference of the pairs is what we measure: no serial check */
+	  saturate_schedule(&sched, cells, sat_pairs, resumed);
+	}
+      else
+	{
+	  schedule_cells(&sched, cells, 0, cells_num, test_groups, resumed);
+	}
+      if (test_groups > 1 && !test_saturate)
+	{
+	  check_num = check_cells(&cells, cells_num, &check_of);
+	  schedule_cells(&sched, cells, cells_num, check_num, 1, NULL);
+	}
+      cells_res = results_open(cells_num + check_num + 1);
+      if (resumed != NULL)
+	{
+	  memcpy(cells_res, resumed, cells_num * sizeof(cell_res_t));
+	  free(resumed);
+	}
+    }
+  if (test_journal != NULL)
+    {
+      journal_open(test_journal);
+    }
+  if (!test_sample)
+    {
+      matrix = cells;		/* check_cells may have moved it */
+    }
+
+  barriers_init(test_cores, test_groups, test_threads);
+
+  volatile cache_line_t* cache_line = cache_line_open();
+  if (test_home || test_dram)
+    {
+      uint32_t g, h;
+      for (g = 0; g < test_groups; g++)
+	{
+	  for (h = 0; h < test_home_slots; h++)
+	    {
+	      volatile cache_line_t* slot = cache_line + ((g * test_home_slots) + h) * test_group_lines;
+	      topo_mem_bind(slot, test_group_lines * sizeof(cache_line_t), home_nodes[h]);
+	      if (test_dram)
+		{
+		  create_rand_list_cl((volatile uint64_t*) slot, 
+				      (test_group_lines * sizeof(cache_line_t)) / sizeof(uint64_t));
+		}
+	    }
+	}
+    }
+
+  fflush(stdout);		/* do not duplicate the buffered output in the children */
+  if (test_smt)
+    {
+      corunners_start(test_groups);
+    }
+  if (!test_verbose)
+    {
+      test_print = 0;
+    }
+
+  run_t run = { test_test, cache_line, cells, cells_res, cells_num, check_num, check_of, sched, 
+		resumed_correction, matrix, matrix_rows, sample_of, { }, char_cols_num, home_nodes, 
+		{ sat_pairs[0], sat_pairs[1] }, NULL, -1 };
+  if (test_server)
+    {
+      run.server_fd = server_open(test_server);
+      signal(SIGPIPE, SIG_IGN);	/* a client that goes away must not take the server with it */
+    }
+  if (serving)
+    {
+      run.req = (request_t*) results_open((sizeof(request_t) / sizeof(cell_res_t)) + 1);
+    }
+  memcpy(run.char_cols, char_cols, sizeof(char_cols));
+
+  uint32_t rank, num_ranks = test_cores * test_groups;
+  if (test_threads)
+    {
+      role_t* roles = (role_t*) calloc(num_ranks, sizeof(role_t));
+      assert(roles != NULL);
+      for (rank = 1; rank < num_ranks; rank++)
+	{
+	  roles[rank].rank = rank;
+	  roles[rank].run = &run;
+	  int e = pthread_create(&roles[rank].thread, NULL, ccbench_thread, roles + rank);
+	  if (e != 0)
+	    {
+	      P("Failure in pthread_create():\n%s", strerror(e));
+	      exit(1);
+	    }
+	}
+
+      int ret = ccbench_role(0, &run);
+      for (rank = 1; rank < num_ranks; rank++)
+	{
+	  pthread_join(roles[rank].thread, NULL);
+	}
+      free(roles);
+      cache_line_close(0, "cache_line");
+      barriers_term(0);
+      return ret;
+    }
+
+  for (rank = 1; rank < num_ranks; rank++) 
+    {
+      pid_t child = fork();
+      if (child < 0) 
+	{
+	  P("Failure in fork():\n%s", strerror(errno));
+	} 
+      else if (child == 0) 
+	{
+	  break;
+	}
+    }
+  if (rank == num_ranks)
+    {
+      rank = 0;
+    }
+
+  int ret = ccbench_role(rank, &run);
+  cache_line_close(rank, "cache_line");
+  barriers_term(rank);
+  return ret;
+}
+
+/* the work of one process (fork backend) or thread (--threads) of the given rank. Everything */
+/* in run is prepared by main and only read here, except for the results */
+static int
+ccbench_role(const uint32_t rank, const run_t* run)
+{
+  volatile cache_line_t* cache_line = run->cache_line;
+  RANK = rank;
+  ID = rank % test_cores;
+  GID = rank / test_cores;
+  barrier_base = BARRIER_GROUP(GID);
+  seeds = seed_rand(test_seed, RANK + 1);
+  cell_t cores = { test_test, { test_core1, test_core2, test_core3 } };
+
+  if (cpu_get()->platform == CPU_NIAGARA && test_cores <= 8 && test_cores > 3 && ID == 0)
+    {
+      PRINT(" ** spreading the 8 threads on the 8 real cores");
+    }
+
+  if (cell_mode())
+    {
+      set_cpu(test_cpus[RANK % test_cpus_num]); /* until the first cell */
+    }
+  else
+    {
+      set_cpu(role_core(ID, &cores));
+    }
+
+#if defined(__tile__)
+  tmc_cmem_init(0);		/*   initialize shared memory */
+#endif  /* TILERA */
+
+  B0;
+  if (ID < 3 || test_scenario != NULL || test_plugin != NULL)
+    {
+      PFDINIT(test_reps);
+      if (test_mem_node >= 0)
+	{
+	  uint32_t st;
+	  for (st = 0; st < PFD_NUM_STORES; st++)
+	    {
+	      topo_mem_bind(pfd_store[st], test_reps * sizeof(ticks), test_mem_node);
+	    }
+	}
+    }
+  B0;
+
+  if (run->req != NULL)
+    {
+      serve(cache_line, run->req, run->server_fd);
+      BG;
+      return 0;
+    }
+
+  if (cell_mode())
+    {
+      if (test_journal != NULL)
+	{
+	  /* the last result slot is not a cell: rank 0 sets its flag if we cannot continue */
+	  cell_res_t* stop = run->cells_res + run->cells_num + run->check_num;
+	  if (RANK == 0)
+	    {
+	      stop->flagged = !journal_calibrate(run->resumed_correction);
+	    }
+	  BG;
+	  if (stop->flagged)
+	    {
+	      BG;
+	      return 1;
+	    }
+	}
+
+      run_cells(cache_line + GID * test_home_slots * test_group_lines, run->cells, run->cells_res, 
+		&run->sched, run->cells_num);
+      if (RANK == 0 && run->check_num)
+	{
+	  check_report(run->cells, run->cells_res, run->cells_num, run->check_of, run->check_num);
+	}
+      if (RANK == 0 && test_sweep3)
+	{
+	  print_sweep3(run->cells, run->cells_res, run->cells_num);
+	}
+      else if (RANK == 0 && test_characterize)
+	{
+	  print_characterize(run->cells, run->cells_res, run->char_cols, run->char_cols_num);
+	}
+      else if (RANK == 0 && test_home)
+	{
+	  print_home(run->cells, run->cells_res, run->home_nodes, test_home_slots);
+	}
+      else if (RANK == 0 && test_dram)
+	{
+	  print_dram(run->cells, run->cells_res, run->home_nodes, test_home_slots);
+	}
+      else if (RANK == 0 && test_saturate)
+	{
+	  print_saturate(run->cells, run->cells_res, run->sat_pairs);
+	}
+      else if (RANK == 0)
+	{
+	  uint32_t matrix_num = run->matrix_rows * test_cpus_num;
+	  cell_res_t* matrix_res = run->cells_res;
+	  if (test_sample)
+	    {
+	      matrix_res = infer_matrix(run->matrix, matrix_num, run->cells_res, run->sample_of, 
+					run->cells_num);
+	    }
+	  print_matrix(run->matrix, matrix_res, run->matrix_rows, test_cpus_num);
+	  if (test_sample)
+	    {
+	      print_matrix_source(run->matrix, matrix_res, run->matrix_rows, test_cpus_num);
+	    }
+	  if (test_topology)
+	    {
+	      cluster_matrix(run->matrix, matrix_res, matrix_num);
+	    }
+	}
+      if (RANK == 0 && test_smt)
+	{
+	  corunners_stop(test_groups);
+	}
+      BG;
+      return 0;
+    }
+
+  /* /\********************************************************************************* */
+  /*  *  main functionality */
+  /*  *********************************************************************************\/ */
+
+  uint64_t sum = run_test(&cache_line);
+
+  /* every ID prints the stores that its steps measure into */
+  scen_plan_t plan;
+  scenario_plan(scenario_get(test_test), ID, &plan);
+  uint32_t id;
+  for (id = 0; id < test_cores; id++)
+    {
+      if (ID == id && (ID < 3 || test_scenario != NULL || test_plugin != NULL) && plan.slots)
+	{
+	  PRINT(" *** Core %2d ************************************************************************************", ID);
+	  uint32_t slot;
+	  for (slot = 0; slot < PFD_NUM_STORES; slot++)
+	    {
+	      if (plan.slots & (1 << slot))
+		{
+		  if (test_scenario != NULL)
+		    {
+		      PRINT(" ** store %s", test_script_stores[slot]);
+		    }
+		  PFDPN(slot, test_reps, test_print);
+		}
+	    }
+	}
+      B0;
+    }
+  B10;
+
+  if (ID == 0)
+    {
+      scenario_describe(scenario_get(test_test));
+    }
+
+  B0;
+
+
+  if (ID < 3)
+    {
+      PRINT(" value of cl is %-10u / sum is %llu", cache_line->word[0], (LLU) sum);
+    }
+  return 0;
+}
+
+/* the entry of the threads of --threads: the thread-local state starts from the values of main */
+static void*
+ccbench_thread(void* arg)
+{
+  role_t* r = (role_t*) arg;
+  test_test = r->run->test;
+  r->ret = ccbench_role(r->rank, r->run);
+  return NULL;
+}
+
+/* does the step record a measurement in its pfd store? */
+static int
+step_measures(const scen_step_t* step)
+{
+  if (step->slot == SCEN_UNTIMED)
+    {
+      return 0;
+    }
+
+  switch (step->kernel)
+    {
+    case K_NONE:
+    case K_STORE_NO_PF:
+    case K_LOAD_NO_PF:
+    case K_CAS_NO_PF:
+    case K_PONG:
+    case K_CAS_ARM:
+    case K_TAS_ARM:
+    case K_TAS_SET:
+    case K_TAS_RELEASE:
+      return 0;
+    default:
+      return 1;
+    }
+}
+
+/* the scenario of the event (of a plugin past NUM_EVENTS), or the one of --scenario */
+static const scenario_t*
+scenario_get(const moesi_type_t event)
+{
+  if (test_scenario != NULL)
+    {
+      return &test_script;
+    }
+  return (event >= NUM_EVENTS) ? &plugin_scen : &scenarios[event];
+}
+
+/* the steps of id in scen, per phase. An id without steps of its own takes the SCEN_OTHERS ones */
+static void
+scenario_plan(const scenario_t* scen, const uint32_t id, scen_plan_t* plan)
+{
+  uint32_t role = SCEN_OTHERS;
+  const scen_step_t* s;
+  for (s = scen->step; s < scen->step + SCEN_STEPS && s->kernel != K_NONE; s++)
+    {
+      if (s->role == id)
+	{
+	  role = id;
+	}
+    }
+
+  memset(plan, 0, sizeof(scen_plan_t));
+  for (s = scen->step; s < scen->step + SCEN_STEPS && s->kernel != K_NONE; s++)
+    {
+      if (s->role == role)
+	{
+	  plan->step[s->phase][plan->num[s->phase]++] = *s;
+	  if (step_measures(s))
+	    {
+	      plan->slots |= 1 << s->slot;
+	    }
+	}
+    }
+}
+
+/* an inline kernel: op, timed into the store of the step unless the step is untimed. The */
+/* value of the PFDT region is val, the argument arg */
+#define STEP_TIMED(step, name, body, op, arg)				\
+  if ((step)->slot == SCEN_UNTIMED)					\
+    {									\
+      op;								\
+    }									\
+  else									\
+    {									\
+      PFDT((step)->slot, reps, name, body, op, val, w, arg);		\
+    }
+
+/* runs the kernel of a step; returns what the kernel read, for the sum */
+static inline uint64_t
+scenario_step(const scen_step_t* step, volatile cache_line_t* cache_line, volatile uint64_t reps)
+{
+  volatile uint32_t* w = cache_line->word;
+  volatile uint64_t val = 0;
+
+  switch (step->kernel)
+    {
+    case K_STORE:
+      if (step->slot)
+	{
+	  store_0_eventually_pfd1(cache_line, reps);
+	}
+      else
+	{
+	  store_0_eventually(cache_line, reps);
+	}
+      return 0;
+    case K_STORE_ONE:
+      store_0(cache_line, reps);
+      return 0;
+    case K_STORE_NO_PF:
+      store_0_no_pf(cache_line, reps);
+      return 0;
+    case K_LOAD:
+      return load_0_eventually(cache_line, reps);
+    case K_LOAD_ONE:
+      return load_0(cache_line, reps);
+    case K_LOAD_NO_PF:
+      return load_0_eventually_no_pf(cache_line, reps);
+    case K_CHASE:
+      return load_next((volatile uint64_t*) cache_line, reps);
+    case K_INVALIDATE:
+      invalidate(cache_line, 0, reps);
+      return 0;
+    case K_CAS:
+      return cas(cache_line, reps);
+    case K_CAS_EVENTUALLY:
+      return cas_0_eventually(cache_line, reps);
+    case K_CAS_NO_PF:
+      return cas_no_pf(cache_line, reps);
+    case K_FAI:
+      return fai(cache_line, reps);
+    case K_TAS:
+      return tas(cache_line, reps);
+    case K_SWAP:
+      return swap(cache_line, reps);
+    case K_LFENCE:
+      STEP_TIMED(step, "lfence", PFD_ASM_LFENCE, _mm_lfence(), 0);
+      return 0;
+    case K_SFENCE:
+      STEP_TIMED(step, "sfence", PFD_ASM_SFENCE, _mm_sfence(), 0);
+      return 0;
+    case K_MFENCE:
+      STEP_TIMED(step, "mfence", PFD_ASM_MFENCE, _mm_mfence(), 0);
+      return 0;
+    case K_PAUSE:
+      STEP_TIMED(step, "pause", PFD_ASM_PAUSE, _mm_pause(), 0);
+      return 0;
+    case K_NOP:
+      STEP_TIMED(step, "nop", PFD_ASM_NOP, asm volatile ("nop"), 0);
+      return 0;
+    case K_EMPTY:
+      STEP_TIMED(step, "empty", PFD_ASM_EMPTY, asm volatile (""), 0);
+      return 0;
+    case K_OP_STORE:
+      val = reps;
+      STEP_TIMED(step, "store", PFD_ASM_STORE, w[0] = reps, 0);
+      return 0;
+    case K_OP_LOAD:
+      STEP_TIMED(step, "load", PFD_ASM_LOAD, val = w[0], 0);
+      return val;
+    case K_OP_CAS:
+      val = reps & 0x1;
+      STEP_TIMED(step, "cas", PFD_ASM_CAS, val = CAS_U32(w, reps & 0x1, !(reps & 0x1)), !(reps & 0x1));
+      return val;
+    case K_OP_FAI:
+      val = 1;
+      STEP_TIMED(step, "fai", PFD_ASM_FAI, val = FAI_U32(w), 0);
+      return val;
+    case K_OP_TAS:
+      val = 0xFF;
+#if defined(__tile__)
+      STEP_TIMED(step, "tas", PFD_ASM_TAS, val = TAS_U8(w), 0);
+#else
+      STEP_TIMED(step, "tas", PFD_ASM_TAS, val = TAS_U8((volatile uint8_t*) w), 0);
+#endif
+      return val;
+    case K_OP_SWAP:
+      val = ID;
+      STEP_TIMED(step, "swap", PFD_ASM_SWAP, val = SWAP_U32(w, ID), 0);
+      return val;
+    case K_OP_FLUSH:
+      STEP_TIMED(step, "clflush", PFD_ASM_CLFLUSH, _mm_clflush((void*) w), 0);
+      _mm_mfence();
+      return 0;
+    case K_PLUGIN:
+      return test_plugin->measure(cache_line, ID, step->phase, reps);
+    case K_PING:
+      ping_pong_0(cache_line, reps);
+      return 0;
+    case K_PONG:
+      ping_pong_1(cache_line, reps);
+      return 0;
+    case K_CAS_ARM:
+      if (test_ao_success)
+	{
+	  cache_line->word[0] = reps & 0x01;
+	}
+      return 0;
+    case K_TAS_ARM:
+      if (!test_ao_success)
+	{
+	  cache_line->word[0] = 0xFFFFFFFF;
+	  _mm_mfence();
+	}
+      return 0;
+    case K_TAS_SET:
+      cache_line->word[0] = test_ao_success ? 0 : 0xFFFFFFFF;
+      return 0;
+    case K_TAS_RELEASE:
+      _mm_mfence();
+      cache_line->word[0] = 0;
+      return 0;
+    default:
+      return 0;
+    }
+}
+
+/* runs the test_reps repetitions of test_test on the calling core: the steps of the role of ID */
+/* in every phase of the scenario of the event. With --epoch K, a round of barriers takes K */
+/* lines, one stride apart, through every phase, and repetition k * rounds + round is the one */
+/* of line k, so that every line sees consecutive repetitions. For the events that need a */
+/* fresh cache line on every repetition, cache_line is advanced and written back to *cache_linep */
+static uint64_t
+run_test(volatile cache_line_t** cache_linep)
+{
+  volatile cache_line_t* cache_line = *cache_linep;
+  const scenario_t* scen = scenario_get(test_test);
+  const uint32_t advance = test_advances(test_test);
+  const uint32_t epoch = (test_test == LOAD_FROM_MEM_SIZE) ? 1 : test_epoch;
+  const uint64_t rounds = test_reps / epoch;
+  uint64_t sum = 0;
+  uint32_t k;
+
+  access_init();
+
+  scen_plan_t plan;
+  scenario_plan(scen, ID, &plan);
+  if (test_plugin != NULL && test_plugin->prepare != NULL && ID < test_plugin->roles)
+    {
+      for (k = 0; k < epoch; k++)
+	{
+	  test_plugin->prepare(cache_line + k * test_stride, ID);
+	}
+    }
+
+  uint64_t round;
+  for (round = 0; round < rounds; round++)
+    {
+      if (test_flush)
+	{
+	  _mm_mfence();
+	  for (k = 0; k < epoch; k++)
+	    {
+	      _mm_clflush((void*) (cache_line + k * test_stride));
+	    }
+	  _mm_mfence();
+	}
+
+      B0;			/* BARRIER 0 */
+
+      uint32_t p, s;
+      for (p = 0; p < scen->phases; p++)
+	{
+	  for (k = 0; k < epoch; k++)
+	    {
+	      volatile cache_line_t* cl = cache_line + k * test_stride;
+	      const uint64_t reps = k * rounds + round;
+	      for (s = 0; s < plan.num[p]; s++)
+		{
+		  sum += scenario_step(&plan.step[p][s], cl, reps);
+		}
+	    }
+	  if (p + 1 < scen->phases)
+	    {
+	      BP(p);		/* BARRIER 1, 2 */
+	    }
+	}
+
+      if (advance)
+	{
+	  cache_line += epoch * test_stride;
+	}
+
+      B3;			/* BARRIER 3 */
+    }
+
+  *cache_linep = cache_line;
+  return sum;
+}
+
+/* the description of the results of the scenario, for the current settings */
+static void
+scenario_describe(const scenario_t* scen)
+{
+  const scen_des_t* d;
+  for (d = scen->des; d < scen->des + SCEN_DES && d->text != NULL; d++)
+    {
+      int show;
+      switch (d->cond)
+	{
+	case DES_FLUSH:
+	  show = test_flush;
+	  break;
+	case DES_NO_FLUSH:
+	  show = !test_flush;
+	  break;
+	case DES_CORES_LT3:
+	  show = test_cores < 3;
+	  break;
+	case DES_CORES_GE3:
+	  show = test_cores >= 3;
+	  break;
+	case DES_CORES_EQ3:
+	  show = test_cores == 3;
+	  break;
+	case DES_CORES_NE3:
+	  show = test_cores != 3;
+	  break;
+	default:
+	  show = 1;
+	  break;
+	}
+      if (!show)
+	{
+	  continue;
+	}
+
+      uint32_t arg = 0;
+      switch (d->arg)
+	{
+	case DES_ARG_CAS_SUCCESS:
+	  arg = 50 + test_ao_success * 50;
+	  break;
+	case DES_ARG_TAS_SUCCESS:
+	  arg = test_ao_success * 100;
+	  break;
+	case DES_ARG_ROUNDS:
+	  arg = PING_PONG_ROUNDS;
+	  break;
+	case DES_ARG_MEM_KIB:
+	  arg = test_mem_size / 1024;
+	  break;
+	}
+
+      printf("[%02d]  ** ", ID);
+      printf(d->text, arg);
+      printf("\n");
+    }
+
+  if (scen == &plugin_scen && test_plugin->describe != NULL)
+    {
+      test_plugin->describe();
+    }
+
+  /* the steps of --scenario describe themselves */
+  const scen_step_t* s;
+  for (s = scen->step; scen == &test_script && s < scen->step + SCEN_STEPS && s->kernel != K_NONE; s++)
+    {
+      const scen_op_t* op;
+      for (op = scen_ops; op < scen_ops + SCEN_OPS_NUM && op->kernel != s->kernel; op++)
+	;
+      if (step_measures(s) && op < scen_ops + SCEN_OPS_NUM)
+	{
+	  printf("[%02d]  ** Results from Core %u : %s in phase %u (store %s)\n", ID, s->role, op->name, 
+		 s->phase, test_script_stores[s->slot]);
+	}
+    }
+  fflush(stdout);
+}
+
+/* the slot of the sample store name of --scenario, a new one if it is not there yet, */
+/* -1 if there are no free slots */
+static int32_t
+script_store(const char* name)
+{
+  uint32_t s;
+  for (s = 0; s < test_script_stores_num; s++)
+    {
+      if (!strcmp(test_script_stores[s], name))
+	{
+	  return s;
+	}
+    }
+
+  if (test_script_stores_num == PFD_NUM_STORES)
+    {
+      return -1;
+    }
+  snprintf(test_script_stores[s], SCEN_NAME, "%s", name);
+  return test_script_stores_num++;
+}
+
+/* reads the --scenario file into test_script. One statement per line, # starts a comment: */
+/* "name <text>", "advance", "phase" (starts the next phase), and the steps "<role> <primitive> */
+/* [<store>]": the role (ID) runs the primitive, timed into the named sample store if one is */
+/* given. Returns the number of roles, or 0 and the reason in err */
+static uint32_t
+script_load(const char* path, char* err, const size_t len)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    {
+      snprintf(err, len, "cannot read %s: %s", path, strerror(errno));
+      return 0;
+    }
+
+  memset(&test_script, 0, sizeof(scenario_t));
+  snprintf(test_script_name, SCEN_NAME, "%s", path);
+  test_script_stores_num = 0;
+
+  char line[SERVER_LINE];
+  uint32_t line_num = 0, num_steps = 0, roles = 0;
+  int32_t phase = -1;
+  int failed = 0;
+  while (fgets(line, sizeof(line), f) != NULL)
+    {
+      line_num++;
+      char* hash = strchr(line, '#');
+      if (hash != NULL)
+	{
+	  *hash = '\0';
+	}
+
+      char* save = NULL;
+      char* tok[4];
+      uint32_t n = 0;
+      char* t;
+      for (t = strtok_r(line, " \t\r\n", &save); t != NULL && n < 4; t = strtok_r(NULL, " \t\r\n", &save))
+	{
+	  tok[n++] = t;
+	}
+      if (n == 0)
+	{
+	  continue;
+	}
+
+      if (!strcmp(tok[0], "name") && n == 2)
+	{
+	  snprintf(test_script_name, SCEN_NAME, "%s", tok[1]);
+	  continue;
+	}
+      if (!strcmp(tok[0], "advance") && n == 1)
+	{
+	  test_script.advance = 1;
+	  continue;
+	}
+      if (!strcmp(tok[0], "phase") && n == 1)
+	{
+	  if (++phase == SCEN_PHASES)
+	    {
+	      snprintf(err, len, "line %u: more than %d phases", line_num, SCEN_PHASES);
+	      failed = 1;
+	      break;
+	    }
+	  continue;
+	}
+
+      char* end;
+      long role = strtol(tok[0], &end, 10);
+      if (*end != '\0' || role < 0 || role >= SCEN_OTHERS || n < 2 || n > 3)
+	{
+	  snprintf(err, len, "line %u: not a statement or a \"<role> <primitive> [<store>]\" step", 
+		   line_num);
+	  failed = 1;
+	  break;
+	}
+
+      const scen_op_t* op;
+      for (op = scen_ops; op < scen_ops + SCEN_OPS_NUM && strcmp(op->name, tok[1]); op++)
+	;
+      if (op == scen_ops + SCEN_OPS_NUM)
+	{
+	  snprintf(err, len, "line %u: unknown primitive %s", line_num, tok[1]);
+	  failed = 1;
+	  break;
+	}
+
+      int32_t slot = SCEN_UNTIMED;
+      if (n == 3 && (slot = script_store(tok[2])) < 0)
+	{
+	  snprintf(err, len, "line %u: more than %d sample stores", line_num, PFD_NUM_STORES);
+	  failed = 1;
+	  break;
+	}
+
+      if (num_steps == SCEN_STEPS)
+	{
+	  snprintf(err, len, "line %u: more than %d steps", line_num, SCEN_STEPS);
+	  failed = 1;
+	  break;
+	}
+      if (phase < 0)
+	{
+	  phase = 0;
+	}
+
+      scen_step_t* step = &test_script.step[num_steps++];
+      step->role = role;
+      step->phase = phase;
+      step->kernel = op->kernel;
+      step->slot = slot;
+      if (role >= roles)
+	{
+	  roles = role + 1;
+	}
+    }
+  fclose(f);
+
+  if (failed)
+    {
+      return 0;
+    }
+  if (num_steps == 0)
+    {
+      snprintf(err, len, "no steps in %s", path);
+      return 0;
+    }
+  test_script.phases = phase + 1;
+  return roles;
+}
+
+/* the ccbench_register_t of the plugins: adds event as NUM_EVENTS + plugin_events_num */
+static int
+plugin_register(const ccbench_event_t* event)
+{
+  if (plugin_events_num == PLUGIN_EVENTS_MAX)
+    {
+      printf("* error: --plugin: more than %d events\n", PLUGIN_EVENTS_MAX);
+      return 0;
+    }
+  if (event->name == NULL || strlen(event->name) >= CCBENCH_PLUGIN_NAME || event->measure == NULL)
+    {
+      printf("* error: --plugin: an event needs a name (< %d chars) and a measure callback\n", 
+	     CCBENCH_PLUGIN_NAME);
+      return 0;
+    }
+  if (event_parse(event->name) >= 0 || plugin_event(event->name) >= 0)
+    {
+      printf("* error: --plugin: there is already an event %s\n", event->name);
+      return 0;
+    }
+  if (event->roles == 0 || event->phases == 0 || event->phases > SCEN_PHASES 
+      || event->roles * event->phases > SCEN_STEPS)
+    {
+      printf("* error: --plugin: %s: 1 to %d phases, and at most %d roles x phases\n", event->name, 
+	     SCEN_PHASES, SCEN_STEPS);
+      return 0;
+    }
+
+  uint32_t i = plugin_events_num++;
+  plugin_events[i] = *event;
+  snprintf(plugin_names[i], CCBENCH_PLUGIN_NAME, "%s", event->name);
+  plugin_events[i].name = plugin_names[i];
+  return 1;
+}
+
+/* opens a plugin and lets it register its events. The plugin stays loaded until the exit */
+static void
+plugin_load(const char* path)
+{
+  void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL)
+    {
+      printf("* error: --plugin: %s\n", dlerror());
+      exit(1);
+    }
+
+  ccbench_plugin_init_t init = (ccbench_plugin_init_t) dlsym(handle, CCBENCH_PLUGIN_INIT);
+  if (init == NULL)
+    {
+      printf("* error: --plugin: no " CCBENCH_PLUGIN_INIT " in %s\n", path);
+      exit(1);
+    }
+  if (init(CCBENCH_PLUGIN_VERSION, plugin_register) != 0)
+    {
+      printf("* error: --plugin: the initialization of %s failed\n", path);
+      exit(1);
+    }
+}
+
+/* the event of a plugin by name, -1 if there is no such event */
+static int32_t
+plugin_event(const char* name)
+{
+  uint32_t i;
+  for (i = 0; i < plugin_events_num; i++)
+    {
+      if (!strcasecmp(name, plugin_events[i].name))
+	{
+	  return NUM_EVENTS + i;
+	}
+    }
+  return -1;
+}
+
+/* the scenario of the event of a plugin: every role calls measure in every phase */
+static void
+plugin_scenario(const ccbench_event_t* event, scenario_t* scen)
+{
+  memset(scen, 0, sizeof(scenario_t));
+  scen->phases = event->phases;
+  scen->advance = (event->advance != 0);
+
+  uint32_t r, p, n = 0;
+  for (r = 0; r < event->roles; r++)
+    {
+      for (p = 0; p < event->phases; p++)
+	{
+	  scen_step_t* step = &scen->step[n++];
+	  step->role = r;
+	  step->phase = p;
+	  step->kernel = K_PLUGIN;
+	  step->slot = (event->timed & (1 << r)) ? 0 : SCEN_UNTIMED;
+	}
+    }
+}
+
+uint32_t
+ccbench_rand_line()
+{
+  return clrand();
+}
+
+static uint32_t
+online_cpus(uint32_t** cpus)
+{
+  uint32_t n = 0;
+#if defined(__sparc__) || defined(__tile__)
+  long num = sysconf(_SC_NPROCESSORS_ONLN);
+  *cpus = (uint32_t*) malloc(num * sizeof(uint32_t));
+  assert(*cpus != NULL);
+  for (n = 0; n < num; n++)
+    {
+      (*cpus)[n] = n;
+    }
+#else
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &mask) != 0)
+    {
+      printf("Problem with getting processor affinity: %s\n", strerror(errno));
+      exit(3);
+    }
+
+  *cpus = (uint32_t*) malloc(CPU_COUNT(&mask) * sizeof(uint32_t));
+  assert(*cpus != NULL);
+  int c;
+  for (c = 0; c < CPU_SETSIZE; c++)
+    {
+      if (CPU_ISSET(c, &mask))
+	{
+	  (*cpus)[n++] = c;
+	}
+    }
+#endif
+  return n;
+}
+
+static size_t
+role_core(const uint32_t id, const cell_t* cell)
+{
+  size_t core = 0;
+  switch (id)
+    {
+    case 0:
+    case 1:
+    case 2:
+      core = cell->core[id];
+      break;
+    default:
+      core = (test_roles != NULL) ? test_roles[id] : id - test_core_others;
+    }
+
+  if (cpu_get()->platform == CPU_NIAGARA && test_cores <= 8 && test_cores > 3)
+    {
+      core = id * 8;
+    }
+  return core;
+}
+
+/* the modes that measure many cells in one run */
+static int
+cell_mode()
+{
+  return (test_sweep3 || test_characterize || test_home || test_dram || test_saturate || test_server 
+	  || test_batch || test_matrix);
+}
+
+static uint32_t
+cell_procs(const cell_t* cell)
+{
+  return (cell->procs && cell->procs < test_cores) ? cell->procs : test_cores;
+}
+
+/* is core one of the cpus we are allowed to run on? */
+static int
+core_allowed(const size_t core)
+{
+  uint32_t c;
+  for (c = 0; c < test_cpus_num; c++)
+    {
+      if (test_cpus[c] == core)
+	{
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+/* exits if core is not one of the cpus we are allowed to run on */
+static void
+check_core(const size_t core, const char* role)
+{
+  uint32_t c;
+  if (core_allowed(core))
+    {
+      return;
+    }
+
+  printf("* error: the core %zu of %s is not in the affinity mask of ccbench (", core, role);
+  for (c = 0; c < test_cpus_num; c++)
+    {
+      printf("%s%u", c ? "," : "", test_cpus[c]);
+    }
+  printf(")\n");
+  exit(1);
+}
+
+/* a cell can be measured only if every process is on a different core */
+static int
+cell_valid(const cell_t* cell)
+{
+  uint32_t i, j, procs = cell_procs(cell);
+  for (i = 0; i < procs; i++)
+    {
+      for (j = i + 1; j < procs; j++)
+	{
+	  if (role_core(i, cell) == role_core(j, cell))
+	    {
+	      return 0;
+	    }
+	}
+    }
+  return 1;
+}
+
+/* builds the rows x test_cpus_num cells of the matrix (row-major), returns the num of rows */
+static uint32_t
+matrix_cells(cell_t** cells)
+{
+  uint32_t rows = (test_matrix == 1) ? 1 : test_cpus_num;
+  *cells = (cell_t*) malloc(rows * test_cpus_num * sizeof(cell_t));
+  assert(*cells != NULL);
+
+  uint32_t r, c;
+  for (r = 0; r < rows; r++)
+    {
+      for (c = 0; c < test_cpus_num; c++)
+	{
+	  cell_t* cell = *cells + (r * test_cpus_num) + c;
+	  cell->event = test_test;
+	  cell->core[0] = (test_matrix == 1) ? test_core1 : test_cpus[r];
+	  cell->core[1] = test_cpus[c];
+	  cell->core[2] = test_core3;
+	  cell->procs = 0;
+	  cell->corunner = -1;
+	  cell->home = -1;
+	}
+    }
+  return rows;
+}
+
+/* do the two cores of the cell measure the same as the swapped ones? */
+static int
+test_symmetric(const moesi_type_t event)
+{
+  switch (event)
+    {
+    case CAS:
+    case FAI:
+    case TAS:
+    case SWAP:
+    case CAS_CONCURRENT:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+static uint32_t
+num_packages()
+{
+  uint32_t c, num = 1;
+  for (c = 0; c < test_cpus_num; c++)
+    {
+      const topo_cpu_t* t = topo_get(test_cpus[c]);
+      if (t != NULL && t->package >= (int32_t) num)
+	{
+	  num = t->package + 1;
+	}
+    }
+  return num;
+}
+
+static uint32_t
+cpu_package(const uint32_t cpu)
+{
+  const topo_cpu_t* t = topo_get(cpu);
+  return (t != NULL && t->package > 0) ? t->package : 0;
+}
+
+/* the matrix index of the cell with the cores of cell c swapped, -1 if the matrix (-M 1) */
+/* does not have it */
+static int32_t
+matrix_mirror(const uint32_t c)
+{
+  if (test_matrix == 1)
+    {
+      return -1;
+    }
+  return (c % test_cpus_num) * test_cpus_num + c / test_cpus_num;
+}
+
+/* the sampling stratum of a cell: its distance class and the packages of core1 and core2 */
+/* (unordered for the symmetric events) */
+static uint32_t
+cell_stratum(const cell_t* cell, const uint32_t num_pkgs)
+{
+  uint32_t p1 = cpu_package(cell->core[0]), p2 = cpu_package(cell->core[1]);
+  if (test_symmetric(cell->event) && p1 > p2)
+    {
+      uint32_t tmp = p1;
+      p1 = p2;
+      p2 = tmp;
+    }
+  uint32_t cls = topo_pair_class(cell->core[0], cell->core[1]);
+  return (cls * num_pkgs + p1) * num_pkgs + p2;
+}
+
+/* picks (randomly) at most test_sample valid cells of every stratum of the matrix. For the */
+/* symmetric events, a cell is not picked if its swapped pair is. (*sample_of)[k] is the */
+/* matrix index of the k-th picked cell */
+static uint32_t
+sample_cells(const cell_t* matrix, const uint32_t matrix_num, cell_t** cells, uint32_t** sample_of)
+{
+  uint32_t num_pkgs = num_packages();
+  uint32_t* picked = (uint32_t*) calloc(TOPO_NUM_CLASSES * num_pkgs * num_pkgs, sizeof(uint32_t));
+  uint32_t* order = (uint32_t*) malloc(matrix_num * sizeof(uint32_t));
+  uint8_t* taken = (uint8_t*) calloc(matrix_num, sizeof(uint8_t));
+  *cells = (cell_t*) malloc(matrix_num * sizeof(cell_t));
+  *sample_of = (uint32_t*) malloc(matrix_num * sizeof(uint32_t));
+  assert(picked != NULL && order != NULL && taken != NULL && *cells != NULL && *sample_of != NULL);
+
+  uint32_t c;
+  for (c = 0; c < matrix_num; c++)
+    {
+      order[c] = c;
+    }
+  for (c = matrix_num; c > 1; c--)
+    {
+      uint32_t pick = my_random(seeds, seeds + 1, seeds + 2) % c;
+      uint32_t tmp = order[c - 1];
+      order[c - 1] = order[pick];
+      order[pick] = tmp;
+    }
+
+  uint32_t n = 0;
+  for (c = 0; c < matrix_num; c++)
+    {
+      const cell_t* cell = matrix + order[c];
+      uint32_t s = cell_stratum(cell, num_pkgs);
+      if (!cell_valid(cell) || picked[s] >= test_sample)
+	{
+	  continue;
+	}
+
+      int32_t m = matrix_mirror(order[c]);
+      if (test_symmetric(cell->event) && m >= 0 && taken[m])
+	{
+	  continue;
+	}
+
+      picked[s]++;
+      taken[order[c]] = 1;
+    }
+
+  for (c = 0; c < matrix_num; c++)
+    {
+      if (taken[c])
+	{
+	  (*cells)[n] = matrix[c];
+	  (*sample_of)[n++] = c;
+	}
+    }
+
+  free(picked);
+  free(order);
+  free(taken);
+  return n;
+}
+
+static int
+double_cmp(const void* a, const void* b)
+{
+  double da = *(const double*) a;
+  double db = *(const double*) b;
+  return (da > db) - (da < db);
+}
+
+static double
+median_of(double* vals, const uint32_t num)
+{
+  qsort(vals, num, sizeof(double), double_cmp);
+  return (num & 0x1) ? vals[num / 2] : (vals[num / 2 - 1] + vals[num / 2]) / 2.0;
+}
+
+/* the full matrix from the num_cells sampled results: the measured cells, their mirrors for */
+/* the symmetric events, and the stratum (else the class) median for the rest. The medians */
+/* come from one pass: the measured and mirrored values, grouped by stratum. The strata of a */
+/* class are consecutive (see cell_stratum), so the values of a class are too */
+static cell_res_t*
+infer_matrix(const cell_t* matrix, const uint32_t matrix_num, const cell_res_t* res,
+	     const uint32_t* sample_of, const uint32_t num_cells)
+{
+  const uint32_t num_pkgs = num_packages();
+  const uint32_t per_class = num_pkgs * num_pkgs;
+  const uint32_t num_strata = TOPO_NUM_CLASSES * per_class;
+  cell_res_t* mres = (cell_res_t*) calloc(matrix_num, sizeof(cell_res_t));
+  double* vals = (double*) malloc(matrix_num * sizeof(double));
+  uint32_t* stratum = (uint32_t*) malloc(matrix_num * sizeof(uint32_t));
+  uint32_t* first = (uint32_t*) calloc(num_strata + 1, sizeof(uint32_t));
+  uint32_t* at = (uint32_t*) malloc(num_strata * sizeof(uint32_t));
+  double* stratum_med = (double*) malloc(num_strata * sizeof(double));
+  double class_med[TOPO_NUM_CLASSES];
+  assert(mres != NULL && vals != NULL && stratum != NULL && first != NULL && at != NULL 
+	 && stratum_med != NULL);
+
+  uint32_t k, c, st;
+  for (k = 0; k < num_cells; k++)
+    {
+      mres[sample_of[k]] = res[k];
+      mres[sample_of[k]].source = RES_MEASURED;
+    }
+
+  for (c = 0; c < matrix_num; c++)
+    {
+      const int32_t m = matrix_mirror(c);
+      if (!mres[c].done && cell_valid(matrix + c) && test_symmetric(matrix[c].event) 
+	  && m >= 0 && mres[m].done && mres[m].source == RES_MEASURED)
+	{
+	  mres[c] = mres[m];
+	  mres[c].source = RES_MIRRORED;
+	}
+    }
+
+  for (c = 0; c < matrix_num; c++)
+    {
+      if (cell_valid(matrix + c))
+	{
+	  stratum[c] = cell_stratum(matrix + c, num_pkgs);
+	  first[stratum[c] + 1] += mres[c].done;
+	}
+    }
+  for (st = 0; st < num_strata; st++)
+    {
+      first[st + 1] += first[st];
+      at[st] = first[st];
+    }
+  for (c = 0; c < matrix_num; c++)
+    {
+      if (mres[c].done && cell_valid(matrix + c))
+	{
+	  vals[at[stratum[c]]++] = mres[c].median;
+	}
+    }
+
+  /* the strata first: the median of a class sorts the values of its strata again */
+  for (st = 0; st < num_strata; st++)
+    {
+      if (first[st + 1] > first[st])
+	{
+	  stratum_med[st] = median_of(vals + first[st], first[st + 1] - first[st]);
+	}
+    }
+  uint32_t cls;
+  for (cls = 0; cls < TOPO_NUM_CLASSES; cls++)
+    {
+      const uint32_t lo = first[cls * per_class], hi = first[(cls + 1) * per_class];
+      if (hi > lo)
+	{
+	  class_med[cls] = median_of(vals + lo, hi - lo);
+	}
+    }
+
+  for (c = 0; c < matrix_num; c++)
+    {
+      if (mres[c].done || !cell_valid(matrix + c))
+	{
+	  continue;
+	}
+
+      st = stratum[c];
+      cls = st / per_class;
+      if (first[st + 1] > first[st])
+	{
+	  mres[c].median = mres[c].avg = stratum_med[st];
+	  mres[c].source = RES_STRATUM;
+	  mres[c].done = 1;
+	}
+      else if (first[(cls + 1) * per_class] > first[cls * per_class])
+	{
+	  mres[c].median = mres[c].avg = class_med[cls];
+	  mres[c].source = RES_CLASS;
+	  mres[c].done = 1;
+	}
+    }
+
+  free(vals);
+  free(stratum);
+  free(first);
+  free(at);
+  free(stratum_med);
+  return mres;
+}
+
+/* the results are written by the process that holds the target measurement, so they */
+/* have to be shared by all processes */
+static cell_res_t*
+results_open(const uint32_t num_cells)
+{
+  size_t size = num_cells * sizeof(cell_res_t);
+  if (size == 0)
+    {
+      size = sizeof(cell_res_t);
+    }
+  cell_res_t* res = (cell_res_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, 
+				       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (res == MAP_FAILED)
+    {
+      perror("results mmap");
+      exit(134);
+    }
+  memset(res, 0, size);
+  return res;
+}
+
+/* does the event use a fresh cache line on every repetition? */
+static int
+test_advances(const moesi_type_t event)
+{
+  if (test_flush)
+    {
+      return 0;
+    }
+
+  return scenario_get(event)->advance;
+}
+
+/* the features that the steps of the event, the flush of -f, and the fence level (-e) need, */
+/* but that the processor does not have */
+static uint32_t
+test_missing(const moesi_type_t event, const uint32_t fence)
+{
+  uint32_t need = 0, lfence, sfence;
+  if (test_flush)
+    {
+      need |= CPU_CLFLUSH;
+    }
+  fence_levels(fence, &lfence, &sfence);
+  if (lfence || sfence)
+    {
+      need |= CPU_FENCES;
+    }
+
+  const scen_step_t* s;
+  const scenario_t* scen = scenario_get(event);
+  for (s = scen->step; s < scen->step + SCEN_STEPS && s->kernel != K_NONE; s++)
+    {
+      switch (s->kernel)
+	{
+	case K_INVALIDATE:
+	case K_OP_FLUSH:
+	  need |= CPU_CLFLUSH;
+	  break;
+	case K_LFENCE:
+	case K_SFENCE:
+	case K_MFENCE:
+	  need |= CPU_FENCES;
+	  break;
+	case K_PAUSE:
+	  need |= CPU_PAUSE;
+	  break;
+	default:
+	  break;
+	}
+    }
+  return need & ~cpu_get()->features;
+}
+
+/* do the cache lines suffice for the test_reps repetitions of the event? */
+static int
+test_fits(const moesi_type_t event)
+{
+  if (!test_advances(event))
+    {
+      return ((uint64_t) test_epoch * test_stride) <= test_group_lines;
+    }
+  return ((uint64_t) test_reps * test_stride) <= test_group_lines;
+}
+
+/* the number of cache lines that one run of the event touches */
+static uint32_t
+test_lines_used(const moesi_type_t event)
+{
+  uint32_t lines = test_stride * test_epoch;
+  if (test_advances(event))
+    {
+      lines = test_stride * test_reps;
+    }
+
+  if (lines > test_group_lines)
+    {
+      lines = test_group_lines;
+    }
+  return lines;
+}
+
+/* the fields of a cell that a journal line records */
+static int
+cell_same(const cell_t* a, const cell_t* b)
+{
+  return (a->event == b->event && a->core[0] == b->core[0] && a->core[1] == b->core[1] 
+	  && a->core[2] == b->core[2] && a->corunner == b->corunner && a->home == b->home);
+}
+
+/* the settings that must match for the cells of a journal to be reused */
+static void
+journal_settings(char* buf, const size_t len)
+{
+  int n = snprintf(buf, len, "settings test=%u cores=%u reps=%u stride=%u fence=%u flush=%u success=%u "
+		   "mem_size=%zu mem_node=%d matrix=%u sweep3=%u characterize=%u smt=%u home=%u dram=%u "
+		   "saturate=%u core1=%u core3=%u cpus=%u", test_test, test_cores, test_reps, test_stride, 
+		   test_fence, test_flush, test_ao_success, test_mem_size, test_mem_node, test_matrix, 
+		   test_sweep3, test_characterize, test_smt, test_home, test_dram, test_saturate, test_core1, 
+		   test_core3, test_cpus_num);
+  /* only with an epoch, so that the journals of before --epoch can still be resumed */
+  if (test_epoch > 1 && n > 0 && (size_t) n < len)
+    {
+      n += snprintf(buf + n, len - n, " epoch=%u", test_epoch);
+    }
+  /* with --sample, the seed decides which cells are measured */
+  if (test_sample > 0 && n > 0 && (size_t) n < len)
+    {
+      n += snprintf(buf + n, len - n, " sample=%u seed=%llu", test_sample, (LLU) test_seed);
+    }
+  if (n > 0 && (size_t) n < len)
+    {
+      snprintf(buf + n, len - n, "\n");
+    }
+}
+
+/* the seed of the settings of the journal at path (of a --sample run), for --resume to draw */
+/* the same cells. Returns 0 if the journal has none */
+static int
+journal_seed(const char* path, uint64_t* seed)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    {
+      return 0;			/* journal_resume reports it */
+    }
+
+  char line[JOURNAL_LINE];
+  int found = 0;
+  while (!found && fgets(line, JOURNAL_LINE, f) != NULL)
+    {
+      char* p = strstr(line, " seed=");
+      if (!strncmp(line, "settings ", 9) && p != NULL)
+	{
+	  unsigned long long s;
+	  if (sscanf(p, " seed=%llu", &s) == 1)
+	    {
+	      *seed = s;
+	      found = 1;
+	    }
+	}
+    }
+  fclose(f);
+  return found;
+}
+
+/* reads the journal at path into res (indexed like cells) and the pfd correction it was */
+/* taken with. Exits if the settings of the journal do not match ours */
+static uint32_t
+journal_resume(const char* path, const cell_t* cells, const uint32_t num_cells, 
+	       cell_res_t* res, double* correction)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    {
+      printf("* error: cannot open the journal %s: %s\n", path, strerror(errno));
+      exit(1);
+    }
+
+  char settings[JOURNAL_LINE], line[JOURNAL_LINE];
+  journal_settings(settings, JOURNAL_LINE);
+
+  uint32_t n = 0, matched = 0;
+  while (fgets(line, JOURNAL_LINE, f) != NULL)
+    {
+      if (!strncmp(line, "settings ", 9))
+	{
+	  if (strcmp(line, settings))
+	    {
+	      printf("* error: the settings of the journal %s do not match:\n  %s  %s", path, line, settings);
+	      exit(1);
+	    }
+	  matched = 1;
+	}
+      else if (!strncmp(line, "calibration ", 12))
+	{
+	  sscanf(line, "calibration correction=%lf", correction);
+	}
+      else if (!strncmp(line, "cell ", 5))
+	{
+	  cell_t cell;
+	  cell_res_t cr;
+	  uint32_t idx, event;
+	  memset(&cr, 0, sizeof(cr));
+	  if (sscanf(line, "cell idx=%u event=%u core0=%u core1=%u core2=%u corunner=%d home=%d median=%lf "
+		     "avg=%lf std_dev=%lf", &idx, &event, cell.core, cell.core + 1, cell.core + 2, 
+		     &cell.corunner, &cell.home, &cr.median, &cr.avg, &cr.std_dev) != 10)
+	    {
+	      continue;		/* e.g., the last line was cut */
+	    }
+	  cell.event = event;
+
+	  /* the same settings and seed give the same cells, but check the index against the cell */
+	  if (idx >= num_cells || !cell_same(cells + idx, &cell))
+	    {
+	      for (idx = 0; idx < num_cells && !cell_same(cells + idx, &cell); idx++)
+		;
+	    }
+	  if (idx < num_cells && !res[idx].done)
+	    {
+	      cr.done = 1;
+	      res[idx] = cr;
+	      n++;
+	    }
+	}
+    }
+  fclose(f);
+
+  if (!matched)
+    {
+      printf("* error: %s is not a journal (no settings line)\n", path);
+      exit(1);
+    }
+  return n;
+}
+
+static void
+journal_open(const char* path)
+{
+  int flags = O_WRONLY | O_CREAT | O_APPEND;
+  if (!test_resume)
+    {
+      flags |= O_TRUNC;
+    }
+  journal_fd = open(path, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (journal_fd < 0)
+    {
+      printf("* error: cannot open the journal %s: %s\n", path, strerror(errno));
+      exit(1);
+    }
+}
+
+/* a line is appended with a single write, so that the processes do not mix their lines */
+static void
+journal_write(const char* line)
+{
+  if (write(journal_fd, line, strlen(line)) < 0 || fdatasync(journal_fd) < 0)
+    {
+      printf("* warning: cannot write to the journal: %s\n", strerror(errno));
+    }
+}
+
+/* a new journal starts with the settings and the pfd correction. On --resume, the pfd */
+/* correction of the journal is compared with the current one; returns 0 if they differ */
+static int
+journal_calibrate(const double correction)
+{
+  char line[JOURNAL_LINE];
+  if (!test_resume)
+    {
+      journal_settings(line, JOURNAL_LINE);
+      journal_write(line);
+      snprintf(line, JOURNAL_LINE, "calibration correction=%llu\n", (LLU) pfd_correction);
+      journal_write(line);
+      return 1;
+    }
+
+  double diff = ((double) pfd_correction - correction) / correction;
+  if (correction > 0 && (diff > JOURNAL_CORRECTION_TOL || diff < -JOURNAL_CORRECTION_TOL))
+    {
+      printf("* error: the pfd correction is %llu, the journal was taken with %.0f. The cells would not\n"
+	     "  be comparable (is it the same machine and frequency setting?)\n", (LLU) pfd_correction, correction);
+      return 0;
+    }
+  return 1;
+}
+
+static void
+journal_cell(const uint32_t idx, const cell_t* cell, const cell_res_t* res)
+{
+  char line[JOURNAL_LINE];
+  snprintf(line, JOURNAL_LINE, "cell idx=%u event=%u core0=%u core1=%u core2=%u corunner=%d home=%d "
+	   "median=%.2f avg=%.2f std_dev=%.2f\n", idx, cell->event, cell->core[0], cell->core[1], 
+	   cell->core[2], cell->corunner, cell->home, res->median, res->avg, res->std_dev);
+  journal_write(line);
+}
+
+/* the scheduling key of a core: cores that share a physical core (SMT) conflict */
+static int32_t
+core_key(const uint32_t core)
+{
+  const topo_cpu_t* t = topo_get(core);
+  return (t != NULL) ? t->smt_id : (int32_t) core;
+}
+
+static int
+key_used(const int32_t key, const int32_t* used, const uint32_t num_used)
+{
+  uint32_t u;
+  for (u = 0; u < num_used; u++)
+    {
+      if (used[u] == key)
+	{
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+/* appends the rounds for cells [first, first + num) to sched: greedily, every round gets up */
+/* to groups cells whose cores do not conflict, plus a free core to park the idle groups on. */
+/* The cells that are done in skip (if not NULL) are left out */
+static void
+schedule_cells(schedule_t* sched, const cell_t* cells, const uint32_t first, const uint32_t num, 
+	       const uint32_t groups, const cell_res_t* skip)
+{
+  uint8_t* todo = (uint8_t*) malloc(num + 1);
+  int32_t* used = (int32_t*) malloc(groups * (test_cores + 1) * sizeof(int32_t));
+  assert(todo != NULL && used != NULL);
+
+  uint32_t c, left = 0;
+  for (c = 0; c < num; c++)
+    {
+      todo[c] = cell_valid(cells + first + c) && (skip == NULL || !skip[first + c].done);
+      left += todo[c];
+    }
+
+  uint32_t start = 0;
+  while (left)
+    {
+      uint32_t r = sched->rounds++;
+      sched->cell = (int32_t*) realloc(sched->cell, sched->rounds * test_groups * sizeof(int32_t));
+      sched->park = (uint32_t*) realloc(sched->park, sched->rounds * sizeof(uint32_t));
+      assert(sched->cell != NULL && sched->park != NULL);
+
+      int32_t* round = sched->cell + r * test_groups;
+      uint32_t g, num_used = 0;
+      for (g = 0; g < test_groups; g++)
+	{
+	  round[g] = -1;
+	}
+
+      g = 0;
+      for (c = start; c < num && g < groups; c++)
+	{
+	  const cell_t* cell = cells + first + c;
+	  uint32_t id, conflict = 0;
+	  for (id = 0; id < cell_procs(cell); id++)
+	    {
+	      conflict |= key_used(core_key(role_core(id, cell)), used, num_used);
+	    }
+	  if (cell->corunner >= 0)
+	    {
+	      conflict |= key_used(core_key(cell->corunner), used, num_used);
+	    }
+	  if (!todo[c] || conflict)
+	    {
+	      continue;
+	    }
+
+	  for (id = 0; id < cell_procs(cell); id++)
+	    {
+	      used[num_used++] = core_key(role_core(id, cell));
+	    }
+	  if (cell->corunner >= 0)
+	    {
+	      used[num_used++] = core_key(cell->corunner);
+	    }
+	  round[g++] = first + c;
+	  todo[c] = 0;
+	  left--;
+	}
+
+      while (start < num && !todo[start])
+	{
+	  start++;
+	}
+
+      sched->park[r] = test_cpus[0];
+      for (c = 0; c < test_cpus_num; c++)
+	{
+	  if (!key_used(core_key(test_cpus[c]), used, num_used))
+	    {
+	      sched->park[r] = test_cpus[c];
+	      break;
+	    }
+	}
+    }
+
+  free(todo);
+  free(used);
+}
+
+/* appends copies of test_check % of the valid cells (random ones) to *cells, in order to */
+/* re-measure them serially. (*check_of)[k] is the original of the k-th copy */
+static uint32_t
+check_cells(cell_t** cells, const uint32_t num_cells, uint32_t** check_of)
+{
+  uint32_t* valid = (uint32_t*) malloc(num_cells * sizeof(uint32_t));
+  assert(valid != NULL);
+  uint32_t c, num_valid = 0;
+  for (c = 0; c < num_cells; c++)
+    {
+      if (cell_valid(*cells + c))
+	{
+	  valid[num_valid++] = c;
+	}
+    }
+
+  uint32_t num = (num_valid * test_check + 99) / 100;
+  if (num > num_valid)
+    {
+      num = num_valid;
+    }
+
+  *cells = (cell_t*) realloc(*cells, (num_cells + num) * sizeof(cell_t));
+  *check_of = (uint32_t*) malloc((num + 1) * sizeof(uint32_t));
+  assert(*cells != NULL && *check_of != NULL);
+
+  uint32_t k;
+  for (k = 0; k < num; k++)
+    {
+      uint32_t pick = k + (my_random(seeds, seeds + 1, seeds + 2) % (num_valid - k));
+      uint32_t tmp = valid[k];
+      valid[k] = valid[pick];
+      valid[pick] = tmp;
+
+      (*check_of)[k] = valid[k];
+      (*cells)[num_cells + k] = (*cells)[valid[k]];
+    }
+
+  free(valid);
+  return num;
+}
+
+/* flags the cells whose concurrent measurement differs from the serial one */
+static void
+check_report(const cell_t* cells, cell_res_t* res, const uint32_t num_cells, 
+	     const uint32_t* check_of, const uint32_t num_check)
+{
+  uint32_t k, flagged = 0;
+  for (k = 0; k < num_check; k++)
+    {
+      cell_res_t* par = res + check_of[k];
+      const cell_res_t* ser = res + num_cells + k;
+      if (!par->done || !ser->done || ser->median == 0)
+	{
+	  continue;
+	}
+
+      double diff = (par->median - ser->median) / ser->median;
+      if (diff > CHECK_TOLERANCE || diff < -CHECK_TOLERANCE)
+	{
+	  par->flagged = 1;
+	  flagged++;
+	  if (test_verbose)
+	    {
+	      const cell_t* cell = cells + check_of[k];
+	      PRINT(" ** interference on %s cores %u/%u/%u: concurrent %.1f / serial %.1f", 
+		    moesi_type_des[cell->event], cell->core[0], cell->core[1], cell->core[2], 
+		    par->median, ser->median);
+	    }
+	}
+    }
+
+  PRINT(" ** interference check: %u of %u cells re-measured serially differ by more than %.0f%% (*)",
+	flagged, num_check, 100 * CHECK_TOLERANCE);
+}
+
+/* runs the rounds of sched, re-pinning the processes before every round. Every group */
+/* measures its cell of the round on its own cache lines (cache_line), the idle groups (and */
+/* the IDs that do not take part in the cell) wait on the park core. The barriers of a */
+/* group are resized to the processes of its cell, the cache lines and the pfd stores are */
+/* reused */
+static void
+run_cells(volatile cache_line_t* cache_line, const cell_t* cells, cell_res_t* res, 
+	  const schedule_t* sched, const uint32_t num_cells)
+{
+  BG;
+  uint32_t r;
+  for (r = 0; r < sched->rounds; r++)
+    {
+      int32_t c = sched->cell[r * test_groups + GID];
+      if (c >= 0 && ID == 0)
+	{
+	  barriers_resize(barrier_base, cell_procs(cells + c));
+	}
+      BG;
+
+      if (c < 0 || ID >= cell_procs(cells + c))
+	{
+	  set_cpu(sched->park[r]);
+	  BG;
+	  continue;
+	}
+
+      test_test = cells[c].event;
+      const moesi_target_t* target = &moesi_target[test_test];
+
+      volatile cache_line_t* lines = cache_line;
+      if (cells[c].home >= 0)
+	{
+	  lines += node_slot(cells[c].home) * test_group_lines;
+	}
+
+      set_cpu(role_core(ID, cells + c));
+      if (ID == 0 && test_test != LOAD_FROM_MEM_SIZE)
+	{
+	  cache_line_reset(lines, test_lines_used(test_test));
+	}
+      if (ID == 0 && corunners != NULL)
+	{
+	  corunner_t* cr = corunners + GID;
+	  cr->core = cells[c].corunner;
+	  cr->busy = (cells[c].corunner >= 0);
+	  cr->seq++;
+	  while (cr->ack != cr->seq)
+	    {
+	      PAUSE();
+	    }
+	}
+      B0;
+
+      volatile cache_line_t* cl = lines;
+      run_test(&cl);
+
+      if (ID == target->id)
+	{
+	  volatile ticks* vals = pfd_store[target->store];
+	  res[c].median = get_median(vals, test_reps);
+	  abs_deviation_t ad;
+	  get_abs_deviation(vals, test_reps, &ad);
+	  res[c].avg = ad.avg;
+	  res[c].std_dev = ad.std_dev;
+	  res[c].done = 1;
+	  if (journal_fd >= 0 && c < num_cells)
+	    {
+	      journal_cell(c, cells + c, res + c);
+	    }
+	}
+      B0;
+      if (ID == 0 && corunners != NULL)
+	{
+	  corunners[GID].busy = 0;
+	}
+      BG;
+    }
+}
+
+/* the load and store fences of a fence level of --fence, and the name of the level */
+static const char*
+fence_levels(const uint32_t fence, uint32_t* lfence, uint32_t* sfence)
+{
+  const char* des;
+  switch (fence)
+    {
+    case 1:
+      *lfence = *sfence = 1;
+      des = "load & store";
+      break;
+    case 2:
+      *lfence = *sfence = 2;
+      des = "full";
+      break;
+    case 3:
+      *lfence = 1;
+      *sfence = 0;
+      des = "load";
+      break;
+    case 4:
+      *lfence = 0;
+      *sfence = 1;
+      des = "store";
+      break;
+    case 5:
+      *lfence = 2;
+      *sfence = 0;
+      des = "full/none";
+      break;
+    case 6:
+      *lfence = 0;
+      *sfence = 2;
+      des = "none/full";
+      break;
+    case 7:
+      *lfence = 2;
+      *sfence = 1;
+      des = "full/store";
+      break;
+    case 8:
+      *lfence = 1;
+      *sfence = 2;
+      des = "load/full";
+      break;
+    case 9:
+      *lfence = 0;
+      *sfence = 3;
+      des = "double write";
+      break;
+    default:
+      *lfence = *sfence = 0;
+      des = "none";
+      break;
+    }
+  return des;
+}
+
+/* sets test_lfence and test_sfence for the fence level of --fence, selects the kernels of */
+/* these fences and returns the name of the level */
+static const char*
+fence_set(const uint32_t fence)
+{
+  const char* des = fence_levels(fence, &test_lfence, &test_sfence);
+  kernels_select();
+  return des;
+}
+
+/* an event by number or by name, -1 if there is no such event */
+static int32_t
+event_parse(const char* s)
+{
+  char* end;
+  long e = strtol(s, &end, 10);
+  if (*s != '\0' && *end == '\0')
+    {
+      return (e >= 0 && e < NUM_EVENTS) ? (int32_t) e : -1;
+    }
+
+  for (e = 0; e < NUM_EVENTS; e++)
+    {
+      if (!strcasecmp(s, moesi_type_des[e]))
+	{
+	  return e;
+	}
+    }
+  return -1;
+}
+
+/* fills req from a request line of key=value pairs (the defaults are our settings). Returns 0 */
+/* and the reason in err if the line is not a test that we can run */
+static int
+request_parse(char* line, request_t* req, const moesi_type_t event, char* err, const size_t len)
+{
+  cell_t* cell = &req->cell;
+  cell->event = event;
+  cell->core[0] = test_core1;
+  cell->core[1] = test_core2;
+  cell->core[2] = test_core3;
+  cell->corunner = -1;
+  cell->home = -1;
+  req->reps = test_reps;
+  req->fence = test_fence;
+  req->stride = test_stride;
+  req->mem_size = test_mem_size;
+
+  char* save = NULL;
+  char* tok;
+  for (tok = strtok_r(line, " \t\r\n", &save); tok != NULL; tok = strtok_r(NULL, " \t\r\n", &save))
+    {
+      char* val = strchr(tok, '=');
+      if (val == NULL)
+	{
+	  snprintf(err, len, "not a key=value pair: %s", tok);
+	  return 0;
+	}
+      *val++ = '\0';
+
+      if (!strcmp(tok, "event"))
+	{
+	  int32_t e = event_parse(val);
+	  if (e < 0)
+	    {
+	      snprintf(err, len, "unknown event %s", val);
+	      return 0;
+	    }
+	  cell->event = e;
+	}
+      else if (!strncmp(tok, "core", 4) && tok[4] >= '0' && tok[4] < '0' + CELL_CORES && !tok[5])
+	{
+	  cell->core[tok[4] - '0'] = atoi(val);
+	}
+      else if (!strcmp(tok, "reps"))
+	{
+	  req->reps = atoi(val);
+	}
+      else if (!strcmp(tok, "fence"))
+	{
+	  req->fence = atoi(val);
+	}
+      else if (!strcmp(tok, "stride"))
+	{
+	  req->stride = pow2roundup(atoi(val));
+	}
+      else if (!strcmp(tok, "mem_size"))
+	{
+	  req->mem_size = parse_size(val);
+	}
+      else
+	{
+	  snprintf(err, len, "unknown key %s", tok);
+	  return 0;
+	}
+    }
+
+  if (test_missing(cell->event, req->fence))
+    {
+      snprintf(err, len, "event %s with fence %u needs instructions that this processor does not have", 
+	       moesi_type_des[cell->event], req->fence);
+      return 0;
+    }
+
+  cell->procs = event_procs(cell->event);
+  uint32_t id;
+  for (id = 0; id < cell->procs; id++)
+    {
+      if (!core_allowed(cell->core[id]))
+	{
+	  snprintf(err, len, "core%u %u is not in the affinity mask of ccbench", id, cell->core[id]);
+	  return 0;
+	}
+    }
+  if (!cell_valid(cell))
+    {
+      snprintf(err, len, "the cores of the test must be different");
+      return 0;
+    }
+  if (req->reps == 0 || req->reps > test_reps)
+    {
+      snprintf(err, len, "reps must be in 1..%u (-r of ccbench)", test_reps);
+      return 0;
+    }
+  if (req->reps % test_epoch)
+    {
+      snprintf(err, len, "reps must be a multiple of the --epoch %u", test_epoch);
+      return 0;
+    }
+
+  uint64_t lines = req->mem_size / sizeof(cache_line_t);
+  if (lines == 0 || req->mem_size > test_mem_size)
+    {
+      snprintf(err, len, "mem_size must be in %zu..%zu (-m of ccbench)", sizeof(cache_line_t), 
+	       test_mem_size);
+      return 0;
+    }
+  if (cell->event != LOAD_FROM_MEM_SIZE && req->stride >= lines)
+    {
+      snprintf(err, len, "the stride must be below the %llu cache lines of mem_size", (LLU) lines);
+      return 0;
+    }
+  if (req->stride < 2 && test_pattern != ACCESS_NONE && test_decoys > 0)
+    {
+      snprintf(err, len, "stride %u leaves no lines for --pattern %s:%u", req->stride, 
+	       access_pattern_des[test_pattern], test_decoys);
+      return 0;
+    }
+  if (test_advances(cell->event) && (uint64_t) req->reps * req->stride > lines)
+    {
+      snprintf(err, len, "%u reps of %s do not fit in mem_size", req->reps, moesi_type_des[cell->event]);
+      return 0;
+    }
+  if (!test_advances(cell->event) && cell->event != LOAD_FROM_MEM_SIZE 
+      && (uint64_t) test_epoch * req->stride > lines)
+    {
+      snprintf(err, len, "the %u lines of --epoch with stride %u do not fit in mem_size", test_epoch, 
+	       req->stride);
+      return 0;
+    }
+  return 1;
+}
+
+/* the listening Unix socket of --server */
+static int
+server_open(const char* path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    {
+      printf("* error: the socket path %s is too long\n", path);
+      exit(1);
+    }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    {
+      perror("socket");
+      exit(1);
+    }
+  unlink(path);			/* a stale socket of a previous server */
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, 8) < 0)
+    {
+      printf("* error: cannot listen on %s: %s\n", path, strerror(errno));
+      exit(1);
+    }
+  return fd;
+}
+
+/* rank 0: where the requests come from (the client of --server, or the file of --batch) and */
+/* where their results go */
+static FILE* req_in = NULL;
+static FILE* req_out = NULL;
+
+/* rank 0: waits for the next request that can run (the others get an error line back), or */
+/* for "quit" (or the end of the --batch file), and publishes it to the other processes */
+static void
+request_next(const int sock, request_t* req, const moesi_type_t event)
+{
+  char line[SERVER_LINE], err[SERVER_LINE];
+  for (;;)
+    {
+      if (req_in == NULL)
+	{
+	  int fd = accept(sock, NULL, NULL);
+	  if (fd < 0)
+	    {
+	      continue;
+	    }
+	  req_in = req_out = fdopen(fd, "r+");
+	  assert(req_in != NULL);
+	  req->line = 0;
+	}
+
+      if (fgets(line, SERVER_LINE, req_in) == NULL)
+	{
+	  if (test_batch != NULL)
+	    {
+	      req->quit = 1;
+	      break;
+	    }
+	  fclose(req_in);
+	  req_in = req_out = NULL;
+	  continue;
+	}
+      req->line++;
+
+      char* l = line + strspn(line, " \t");
+      if (*l == '\n' || *l == '\r' || *l == '\0' || *l == '#')
+	{
+	  continue;
+	}
+      if (!strncmp(l, "quit", 4))
+	{
+	  fprintf(req_out, "bye\n");
+	  fflush(req_out);
+	  req->quit = 1;
+	  break;
+	}
+      if (request_parse(l, req, event, err, SERVER_LINE))
+	{
+	  break;
+	}
+      fprintf(req_out, "error line=%u msg=\"%s\"\n", req->line, err);
+      fflush(req_out);
+    }
+  _mm_mfence();
+  req->seq++;
+}
+
+/* sets the settings of a request (reps, fence, stride, and memory) on this process, or on */
+/* all the threads with --threads. With req NULL, back to the settings of ccbench */
+static void
+request_settings(const request_t* req)
+{
+  static uint32_t reps, fence, stride, group_lines;
+  if (test_threads && RANK != 0)
+    {
+      return;
+    }
+  if (req == NULL)
+    {
+      test_reps = reps;
+      test_stride = stride;
+      test_group_lines = group_lines;
+      fence_set(fence);
+      return;
+    }
+
+  reps = test_reps;
+  fence = test_fence;
+  stride = test_stride;
+  group_lines = test_group_lines;
+  test_reps = req->reps;
+  test_stride = req->stride;
+  test_group_lines = req->mem_size / sizeof(cache_line_t);
+  fence_set(req->fence);
+}
+
+/* the loop of --server and --batch: rank 0 gets the requests, every process runs them as a */
+/* cell with the machinery of the sweeps, on the pinned processes and the pfd calibration of */
+/* the startup */
+static void
+serve(volatile cache_line_t* cache_line, request_t* req, const int sock)
+{
+  const moesi_type_t event = test_test; /* the default event of the requests */
+  if (RANK == 0 && test_batch != NULL)
+    {
+      req_in = fopen(test_batch, "r");
+      req_out = stdout;
+      assert(req_in != NULL);
+    }
+
+  uint32_t seq = 0;
+  for (;;)
+    {
+      if (RANK == 0)
+	{
+	  request_next(sock, req, event);
+	}
+      else
+	{
+	  while (req->seq == seq && !req->quit)
+	    {
+	      usleep(SERVER_POLL_US);
+	    }
+	}
+      seq = req->seq;
+      BG;
+      if (req->quit)
+	{
+	  break;
+	}
+
+      request_settings(req);
+      if (RANK == 0 && req->cell.event == LOAD_FROM_MEM_SIZE)
+	{
+	  /* the other tests reset the lines: a new list every time */
+	  create_rand_list_cl((volatile uint64_t*) cache_line, req->mem_size / sizeof(uint64_t));
+	}
+      schedule_t sched = { 0, NULL, NULL };
+      schedule_cells(&sched, &req->cell, 0, 1, 1, NULL);
+      memset(&req->res, 0, sizeof(cell_res_t));
+      BG;
+      run_cells(cache_line, &req->cell, &req->res, &sched, 1);
+      free(sched.cell);
+      free(sched.park);
+
+      if (RANK == 0)
+	{
+	  const cell_t* cell = &req->cell;
+	  fprintf(req_out, "result line=%u event=%s core0=%u core1=%u core2=%u reps=%u fence=%u "
+		  "stride=%u mem_size=%zu median=%.2f avg=%.2f std_dev=%.2f\n", req->line, 
+		  moesi_type_des[cell->event], cell->core[0], cell->core[1], cell->core[2], req->reps, 
+		  req->fence, req->stride, req->mem_size, req->res.median, req->res.avg, 
+		  req->res.std_dev);
+	  fflush(req_out);
+	}
+      BG;
+      test_test = event;
+      request_settings(NULL);
+    }
+
+  if (RANK == 0)
+    {
+      if (req_in != NULL)
+	{
+	  fclose(req_in);
+	}
+      if (test_server != NULL)
+	{
+	  close(sock);
+	  unlink(test_server);
+	}
+    }
 }
 
-uint32_t
-cas_no_pf(volatile cache_line_t* cl, volatile uint64_t reps)
+static void
+print_matrix_stat(const cell_t* cells, const cell_res_t* res, const uint32_t rows, 
+		  const uint32_t cols, const uint32_t median)
 {
-  uint8_t o = reps & 0x1;
-  uint8_t no = !o; 
-  volatile uint32_t r;
-  r = CAS_U32(cl->word, o, no);
+  PRINT(" ** %s : %s (cycles) / rows: core1 / columns: core2", moesi_type_des[test_test],
+	median ? "median" : "avg");
+
+  uint32_t r, c;
+  printf("      ");
+  for (c = 0; c < cols; c++)
+    {
+      printf(" %6u", cells[c].core[1]);
+    }
+  printf("\n");
 
-  return (r == o);
+  for (r = 0; r < rows; r++)
+    {
+      printf("%6u", cells[r * cols].core[0]);
+      for (c = 0; c < cols; c++)
+	{
+	  const cell_res_t* cr = res + (r * cols) + c;
+	  if (cr->done)
+	    {
+	      printf(cr->flagged ? " %5.1f*" : " %6.1f", median ? cr->median : cr->avg);
+	    }
+	  else
+	    {
+	      printf(" %6s", "-");
+	    }
+	}
+      printf("\n");
+    }
+  printf("\n");
 }
 
-uint32_t
-cas_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps)
+static void
+print_matrix(const cell_t* cells, const cell_res_t* res, const uint32_t rows, const uint32_t cols)
 {
-  uint8_t o = reps & 0x1;
-  uint8_t no = !o; 
-  volatile uint32_t r;
+  print_matrix_stat(cells, res, rows, cols, 1);
+  print_matrix_stat(cells, res, rows, cols, 0);
+}
 
-  uint32_t cln = 0;
-  do
+/* M = measured / S = mirrored (symmetric) / I = inferred from the cells of the same class and */
+/* packages / C = inferred from the cells of the same class. The last column is the */
+/* confidence of the row: the percentage of its cells that are measured or mirrored */
+static void
+print_matrix_source(const cell_t* cells, const cell_res_t* res, const uint32_t rows, 
+		    const uint32_t cols)
+{
+  static const char source_code[] = "MSIC";
+
+  PRINT(" ** %s : source of the cells (M: measured / S: mirrored / I: inferred from class and "
+	"packages / C: inferred from class)", moesi_type_des[test_test]);
+
+  uint32_t r, c, total[RES_CLASS + 1] = { 0 };
+  printf("      ");
+  for (c = 0; c < cols; c++)
     {
-      cln = clrand();
-      volatile cache_line_t* cl1 = cl + cln;
-      PFDI(0);
-      r = CAS_U32(cl1->word, o, no);
-      PFDO(0, reps);
+      printf(" %3u", cells[c].core[1]);
     }
-  while (cln > 0);
+  printf("   conf\n");
 
-  return (r == o);
+  for (r = 0; r < rows; r++)
+    {
+      uint32_t sure = 0, done = 0;
+      printf("%6u", cells[r * cols].core[0]);
+      for (c = 0; c < cols; c++)
+	{
+	  const cell_res_t* cr = res + (r * cols) + c;
+	  if (cr->done)
+	    {
+	      printf(" %3c", source_code[cr->source]);
+	      sure += (cr->source <= RES_MIRRORED);
+	      done++;
+	      total[cr->source]++;
+	    }
+	  else
+	    {
+	      printf(" %3s", "-");
+	    }
+	}
+      printf("   %3.0f%%\n", done ? (100.0 * sure) / done : 0.0);
+    }
+  printf("measured: %u / mirrored: %u / inferred: %u (class and packages) + %u (class)\n\n", 
+	 total[RES_MEASURED], total[RES_MIRRORED], total[RES_STRATUM], total[RES_CLASS]);
 }
 
-uint32_t
-fai(volatile cache_line_t* cl, volatile uint64_t reps)
+/* clusters the medians of the measured cells into latency domains (see topology.c) */
+static void
+cluster_matrix(const cell_t* cells, const cell_res_t* res, const uint32_t num_cells)
 {
-  volatile uint32_t t = 0;
+  uint32_t* c1 = (uint32_t*) malloc(num_cells * sizeof(uint32_t));
+  uint32_t* c2 = (uint32_t*) malloc(num_cells * sizeof(uint32_t));
+  double* lat = (double*) malloc(num_cells * sizeof(double));
+  assert(c1 != NULL && c2 != NULL && lat != NULL);
 
-  uint32_t cln = 0;
-  do
+  uint32_t c, n = 0;
+  for (c = 0; c < num_cells; c++)
     {
-      cln = clrand();
-      volatile cache_line_t* cl1 = cl + cln;
-      PFDI(0);
-      t = FAI_U32(cl1->word);
-      PFDO(0, reps);
+      if (res[c].done && res[c].source <= RES_MIRRORED)
+	{
+	  c1[n] = cells[c].core[0];
+	  c2[n] = cells[c].core[1];
+	  lat[n] = res[c].median;
+	  n++;
+	}
     }
-  while (cln > 0);
 
-  return t;
+  topo_cluster(c1, c2, lat, n);
+  topo_print_domains();
+
+  free(c1);
+  free(c2);
+  free(lat);
 }
 
-uint8_t
-tas(volatile cache_line_t* cl, volatile uint64_t reps)
+/* for every three-party event: the requester is on core1, the owner and the sharer are on */
+/* one representative core for each distance class (from the requester) */
+static uint32_t
+sweep3_cells(cell_t** cells)
 {
-  volatile uint8_t r;
+  *cells = (cell_t*) malloc(THREE_PARTY_NUM * TOPO_NUM_CLASSES * TOPO_NUM_CLASSES * sizeof(cell_t));
+  assert(*cells != NULL);
 
-  uint32_t cln = 0;
-  do
+  int only_one = 0;
+  uint32_t e;
+  for (e = 0; e < THREE_PARTY_NUM; e++)
     {
-      cln = clrand();
-      volatile cache_line_t* cl1 = cl + cln;
-#if defined(TILERA)
-      volatile uint32_t* b = (volatile uint32_t*) cl1->word;
-#else
-      volatile uint8_t* b = (volatile uint8_t*) cl1->word;
-#endif
+      only_one |= (three_party[e].event == test_test);
+    }
+
+  uint32_t n = 0;
+  for (e = 0; e < THREE_PARTY_NUM; e++)
+    {
+      const three_party_t* tp = three_party + e;
+      if (only_one && tp->event != test_test)
+	{
+	  continue;
+	}
+      if (!test_fits(tp->event))
+	{
+	  printf("* warning: skipping %s: %u repetitions with stride %u need more than %u cache lines "
+		 "(use -f or -m)\n", moesi_type_des[tp->event], test_reps, test_stride, test_group_lines);
+	  continue;
+	}
+
+      uint32_t co, cs;
+      for (co = 0; co < TOPO_NUM_CLASSES; co++)
+	{
+	  uint32_t owner;
+	  if (!topo_representative(co, test_core1, NULL, 0, &owner))
+	    {
+	      continue;
+	    }
+	  for (cs = 0; cs < TOPO_NUM_CLASSES; cs++)
+	    {
+	      uint32_t sharer;
+	      if (!topo_representative(cs, test_core1, &owner, 1, &sharer))
+		{
+		  continue;
+		}
+
+	      cell_t* cell = *cells + n++;
+	      cell->event = tp->event;
+	      cell->procs = 0;
+	      cell->corunner = -1;
+	      cell->home = -1;
+	      cell->core[tp->owner] = owner;
+	      cell->core[tp->sharer] = sharer;
+	      cell->core[tp->requester] = test_core1;
+	    }
+	}
+    }
+  return n;
+}
 
-      PFDI(0);
-      r = TAS_U8(b);
-      PFDO(0, reps);
+/* the processes that take part in each event */
+static uint32_t
+event_procs(const moesi_type_t event)
+{
+  uint32_t e;
+  for (e = 0; e < THREE_PARTY_NUM; e++)
+    {
+      if (three_party[e].event == event)
+	{
+	  return 3;
+	}
     }
-  while (cln > 0);
 
-  return (r != 255);
+  switch (event)
+    {
+    case LOAD_FROM_L1:
+    case LOAD_FROM_MEM_SIZE:
+    case LFENCE:
+    case SFENCE:
+    case MFENCE:
+    case PROFILER:
+    case PAUSE:
+    case NOP:
+      return 1;
+    default:
+      return 2;
+    }
 }
 
-uint32_t
-swap(volatile cache_line_t* cl, volatile uint64_t reps)
+/* a core at the distance of col from c1, other than the excl ones */
+static int
+char_representative(const char_col_t* col, const uint32_t c1, const uint32_t* excl, 
+		    const uint32_t num_excl, uint32_t* c2)
 {
-  volatile uint32_t res;
+  if (col->dist < 0)
+    {
+      return topo_representative(col->cls, c1, excl, num_excl, c2);
+    }
 
-  uint32_t cln = 0;
-  do
+  uint32_t i, e;
+  for (i = 0; i < test_cpus_num; i++)
     {
-      cln = clrand();
-      volatile cache_line_t* cl1 = cl + cln;
-      PFDI(0);
-      res = SWAP_U32(cl1->word, ID);
-      PFDO(0, reps);
+      uint32_t c = test_cpus[i];
+      if (topo_pair_class(c1, c) != col->cls 
+	  || topo_node_distance(topo_cpu_node(c1), topo_cpu_node(c)) != col->dist)
+	{
+	  continue;
+	}
+      for (e = 0; e < num_excl && excl[e] != c; e++)
+	;
+      if (e == num_excl)
+	{
+	  *c2 = c;
+	  return 1;
+	}
     }
-  while (cln > 0);
+  return 0;
+}
 
-  _mm_mfence();
-  return res;
+/* keeps its core busy while ctl->busy: spinning on the ALU (--smt 1) or streaming over a */
+/* private buffer (--smt 2). Sleeps otherwise */
+static void
+corunner_run(corunner_t* ctl)
+{
+  volatile uint64_t* buf = (volatile uint64_t*) malloc(CORUNNER_MEM);
+  assert(buf != NULL);
+  memset((void*) buf, 0, CORUNNER_MEM);
+
+  const size_t words = CORUNNER_MEM / sizeof(uint64_t);
+  const size_t step = sizeof(cache_line_t) / sizeof(uint64_t);
+  uint64_t x = 1;
+  size_t w = 0;
+  uint32_t seq = 0;
+  while (!ctl->stop)
+    {
+      if (ctl->seq != seq)
+	{
+	  seq = ctl->seq;
+	  if (ctl->core >= 0)
+	    {
+	      set_cpu(ctl->core);
+	    }
+	  _mm_mfence();
+	  ctl->ack = seq;
+	}
+
+      if (!ctl->busy)
+	{
+	  usleep(100);
+	  continue;
+	}
+
+      uint32_t i;
+      for (i = 0; i < 1024; i++)
+	{
+	  if (test_smt == 1)
+	    {
+	      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+	    }
+	  else
+	    {
+	      buf[w]++;
+	      w = (w + step) % words;
+	    }
+	}
+    }
+  buf[0] = x;			/* keep the ALU loop */
+  exit(0);
 }
 
-void
-store_0(volatile cache_line_t* cl, volatile uint64_t reps)
+/* forks num co-runners (one per group) that are controlled via shared memory */
+static void
+corunners_start(const uint32_t num)
 {
-  if (test_sfence == 0)
+  corunners = (corunner_t*) mmap(NULL, num * sizeof(corunner_t), PROT_READ | PROT_WRITE, 
+				 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (corunners == MAP_FAILED)
     {
-      PFDI(0);
-      cl->word[0] = reps;
-      PFDO(0, reps);
+      perror("corunners mmap");
+      exit(134);
     }
-  else if (test_sfence == 1)
+  memset(corunners, 0, num * sizeof(corunner_t));
+
+  uint32_t g;
+  for (g = 0; g < num; g++)
     {
-      PFDI(0);
-      cl->word[0] = reps;
-      _mm_sfence();
-      PFDO(0, reps);
+      corunners[g].core = -1;
+      pid_t child = fork();
+      if (child < 0)
+	{
+	  P("Failure in fork():\n%s", strerror(errno));
+	}
+      else if (child == 0)
+	{
+	  corunner_run(corunners + g);
+	}
     }
-  else if (test_sfence == 2)
+}
+
+static void
+corunners_stop(const uint32_t num)
+{
+  uint32_t g;
+  for (g = 0; g < num; g++)
     {
-      PFDI(0);
-      cl->word[0] = reps;
-      _mm_mfence();
-      PFDO(0, reps);
+      corunners[g].stop = 1;
     }
 }
 
-void
-store_0_no_pf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* the columns of --characterize: the local distance classes from core1, then one column per */
+/* node distance of the remote sockets (or a single one, if the distances are unknown) */
+static uint32_t
+characterize_cols(char_col_t* cols)
 {
-  cl->word[0] = reps;
-  if (test_sfence == 1)
+  uint32_t n = 0, i, k;
+  topo_class_t cls;
+  for (cls = TOPO_SAME_CORE; cls < TOPO_NUM_CLASSES; cls++)
     {
-      _mm_sfence();
+      char_col_t col = { cls, -1, 0, -1, "" };
+      snprintf(col.name, sizeof(col.name), "%s", topo_class_des[cls]);
+      if (cls != TOPO_REMOTE_SOCKET)
+	{
+	  if (char_representative(&col, test_core1, NULL, 0, &col.core))
+	    {
+	      cols[n++] = col;
+	    }
+	  continue;
+	}
+
+      for (i = 0; i < test_cpus_num && n < CHAR_COLS_MAX; i++)
+	{
+	  uint32_t c = test_cpus[i];
+	  if (topo_pair_class(test_core1, c) != TOPO_REMOTE_SOCKET)
+	    {
+	      continue;
+	    }
+	  col.dist = topo_node_distance(topo_cpu_node(test_core1), topo_cpu_node(c));
+	  for (k = 0; k < n && (cols[k].cls != cls || cols[k].dist != col.dist); k++)
+	    ;
+	  if (k == n)
+	    {
+	      col.core = c;
+	      if (col.dist >= 0)
+		{
+		  snprintf(col.name, sizeof(col.name), "remote (d=%d)", col.dist);
+		}
+	      cols[n++] = col;
+	    }
+	}
     }
-  else if (test_sfence == 2)
+  return n;
+}
+
+/* the columns of --smt: the SMT sibling of core1, the closest other core, and the closest */
+/* other core with the co-runner on the sibling of core1 */
+static uint32_t
+smt_cols(char_col_t* cols)
+{
+  uint32_t n = 0, sibling;
+  int has_sibling = topo_representative(TOPO_SAME_CORE, test_core1, NULL, 0, &sibling);
+  if (has_sibling)
     {
-      _mm_mfence();
+      char_col_t col = { TOPO_SAME_CORE, -1, sibling, -1, "SMT sibling" };
+      cols[n++] = col;
+    }
+  else
+    {
+      printf("* warning: core %u has no SMT sibling\n", test_core1);
+    }
+
+  topo_class_t cls;
+  for (cls = TOPO_SAME_L2; cls < TOPO_NUM_CLASSES; cls++)
+    {
+      char_col_t col = { cls, -1, 0, -1, "" };
+      if (!char_representative(&col, test_core1, NULL, 0, &col.core))
+	{
+	  continue;
+	}
+      snprintf(col.name, sizeof(col.name), "%s", topo_class_des[cls]);
+      cols[n++] = col;
+      if (has_sibling)
+	{
+	  col.corunner = sibling;
+	  snprintf(col.name, sizeof(col.name), "%s (+busy)", topo_class_des[cls]);
+	  cols[n++] = col;
+	}
+      break;
+    }
+  return n;
+}
+
+/* every event x every column (num_cols of them), event-major. The measuring ID of the event */
+/* is on core1, the other IDs on cores of the column. The cells that cannot be placed (and */
+/* the single-core events, except on the first column and on the ones with a co-runner) */
+/* are left invalid */
+static uint32_t
+characterize_cells(cell_t** cells, const char_col_t* cols, const uint32_t num_cols)
+{
+  *cells = (cell_t*) malloc((NUM_EVENTS * num_cols + 1) * sizeof(cell_t));
+  assert(*cells != NULL);
+
+  moesi_type_t e;
+  uint32_t k, id;
+  for (e = 0; e < NUM_EVENTS; e++)
+    {
+      uint32_t procs = event_procs(e);
+      uint32_t target = moesi_target[e].id;
+      int skip = (e == LOAD_FROM_MEM_SIZE || !test_fits(e) || test_missing(e, test_fence));
+      if (test_missing(e, test_fence))
+	{
+	  printf("* warning: skipping %s: it needs instructions that this processor does not have\n", 
+		 moesi_type_des[e]);
+	}
+      else if (skip && e != LOAD_FROM_MEM_SIZE)
+	{
+	  printf("* warning: skipping %s: %u repetitions with stride %u need more than %u cache lines "
+		 "(use -f or -m)\n", moesi_type_des[e], test_reps, test_stride, test_group_lines);
+	}
+
+      for (k = 0; k < num_cols; k++)
+	{
+	  cell_t* cell = *cells + (e * num_cols) + k;
+	  cell->event = e;
+	  cell->procs = 2;
+	  cell->corunner = cols[k].corunner;
+	  cell->home = -1;
+	  for (id = 0; id < CELL_CORES; id++)
+	    {
+	      cell->core[id] = test_core1; /* invalid, unless placed below */
+	    }
+
+	  uint32_t others[CELL_CORES] = { cols[k].core };
+	  if (skip || (procs == 1 && k > 0 && cols[k].corunner < 0)
+	      || (procs > 2 && !char_representative(cols + k, test_core1, others, 1, others + 1)))
+	    {
+	      continue;
+	    }
+
+	  uint32_t o = 0;
+	  cell->procs = procs;
+	  for (id = 0; id < procs; id++)
+	    {
+	      cell->core[id] = (id == target) ? test_core1 : others[o++];
+	    }
+	}
+    }
+  return NUM_EVENTS * num_cols;
+}
+
+/* rows are the events, columns the distance of the other cores from the measuring one */
+static void
+print_characterize(const cell_t* cells, const cell_res_t* res, const char_col_t* cols, 
+		   const uint32_t num_cols)
+{
+  PRINT(" ** median (cycles) of the measuring core %u / columns: distance of the other cores%s", test_core1,
+	test_smt == 1 ? " / co-runner: ALU" : test_smt ? " / co-runner: memory" : "");
+
+  uint32_t k;
+  printf("%-26s", "");
+  for (k = 0; k < num_cols; k++)
+    {
+      printf(" %20s", cols[k].name);
+    }
+  printf("\n%-26s", "(core)");
+  for (k = 0; k < num_cols; k++)
+    {
+      printf(" %20u", cols[k].core);
+    }
+  printf("\n");
+
+  moesi_type_t e;
+  for (e = 0; e < NUM_EVENTS; e++)
+    {
+      const cell_res_t* row = res + (e * num_cols);
+      uint32_t done = 0;
+      for (k = 0; k < num_cols; k++)
+	{
+	  done += row[k].done;
+	}
+      if (!done)
+	{
+	  continue;
+	}
+
+      printf("%-26s", moesi_type_des[e]);
+      for (k = 0; k < num_cols; k++)
+	{
+	  if (row[k].done)
+	    {
+	      printf(row[k].flagged ? " %19.1f*" : " %20.1f", row[k].median);
+	    }
+	  else
+	    {
+	      printf(" %20s", event_procs(e) == 1 ? "" : "-");
+	    }
+	}
+      printf("\n");
+    }
+  printf("\n");
+}
+
+/* the index of the cache lines of node among the ones of a group (see --home) */
+static uint32_t
+node_slot(const int32_t node)
+{
+  int32_t n;
+  uint32_t slot = 0;
+  for (n = 0; n < node; n++)
+    {
+      slot += topo_node_valid(n);
+    }
+  return (slot < test_home_slots) ? slot : 0;
+}
+
+/* a cpu of node, other than the excl ones */
+static int
+node_cpu(const int32_t node, const uint32_t* excl, const uint32_t num_excl, uint32_t* cpu)
+{
+  uint32_t i, e;
+  for (i = 0; i < test_cpus_num; i++)
+    {
+      uint32_t c = test_cpus[i];
+      int32_t cn = topo_cpu_node(c);
+      if (cn != node && !(cn < 0 && node == 0))
+	{
+	  continue;
+	}
+      for (e = 0; e < num_excl && excl[e] != c; e++)
+	;
+      if (e == num_excl)
+	{
+	  *cpu = c;
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+/* the ids of the nodes that get a slot of cache lines (test_home_slots of them) */
+static uint32_t
+home_nodes_get(int32_t* nodes)
+{
+  uint32_t n = 0;
+  int32_t node;
+  for (node = 0; node < (int32_t) topo_num_nodes() && n < test_home_slots; node++)
+    {
+      if (topo_node_valid(node))
+	{
+	  nodes[n++] = node;
+	}
+    }
+  if (n == 0)
+    {
+      nodes[n++] = 0;
+    }
+  return n;
+}
+
+/* home node x owner node x requester node (home-major) for test_test. The requester is the */
+/* measuring ID, the owner is the next ID, on the first cpu of its node, and any other ID */
+/* (e.g., the sharer) on the next cpus of the owner node. The cells that cannot be placed */
+/* (e.g., nodes without cpus) are left invalid. nodes gets the ids of the nodes */
+static uint32_t
+home_cells(cell_t** cells, int32_t* nodes)
+{
+  uint32_t n = home_nodes_get(nodes);
+
+  *cells = (cell_t*) malloc(n * n * n * sizeof(cell_t));
+  assert(*cells != NULL);
+
+  uint32_t procs = event_procs(test_test);
+  uint32_t target = moesi_target[test_test].id;
+  uint32_t h, o, q, id;
+  for (h = 0; h < n; h++)
+    {
+      for (o = 0; o < n; o++)
+	{
+	  for (q = 0; q < n; q++)
+	    {
+	      cell_t* cell = *cells + (((h * n) + o) * n) + q;
+	      cell->event = test_test;
+	      cell->procs = 2;
+	      cell->corunner = -1;
+	      cell->home = nodes[h];
+	      cell->core[0] = cell->core[1] = cell->core[2] = test_cpus[0]; /* invalid */
+
+	      uint32_t cores[CELL_CORES] = { 0 }, placed;
+	      if (!node_cpu(nodes[q], NULL, 0, cores))
+		{
+		  continue;
+		}
+	      for (placed = 1; placed < procs; placed++)
+		{
+		  if (!node_cpu(nodes[o], cores, placed, cores + placed))
+		    {
+		      break;
+		    }
+		}
+	      if (placed < procs)
+		{
+		  continue;
+		}
+
+	      uint32_t other = 1;
+	      cell->procs = procs;
+	      for (id = 0; id < procs; id++)
+		{
+		  cell->core[id] = (id == target) ? cores[0] : cores[other++];
+		}
+	    }
+	}
     }
-}
 
-static void
-store_0_eventually_sf(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  volatile uint32_t cln = 0;
-  do
+  if (!test_fits(test_test))
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(0);
-      w[0] = cln;
-      _mm_sfence();
-      PFDO(0, reps);
+      printf("* error: %u repetitions with stride %u need more than the %u cache lines of a node "
+	     "(use -f or -m)\n", test_reps, test_stride, test_group_lines);
+      exit(1);
     }
-  while (cln > 0);
+  return n * n * n;
 }
 
-static void
-store_0_eventually_mf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* every core x every node (core-major): ID 0 chases the list on the slot of the node */
+static uint32_t
+dram_cells(cell_t** cells, int32_t* nodes)
 {
-  volatile uint32_t cln = 0;
-  do
+  uint32_t n = home_nodes_get(nodes);
+  *cells = (cell_t*) malloc(test_cpus_num * n * sizeof(cell_t));
+  assert(*cells != NULL);
+
+  uint32_t c, h;
+  for (c = 0; c < test_cpus_num; c++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(0);
-      w[0] = cln;
-      _mm_mfence();
-      PFDO(0, reps);
+      for (h = 0; h < n; h++)
+	{
+	  cell_t* cell = *cells + (c * n) + h;
+	  cell->event = LOAD_FROM_MEM_SIZE;
+	  cell->core[0] = cell->core[1] = cell->core[2] = test_cpus[c];
+	  cell->procs = 1;
+	  cell->corunner = -1;
+	  cell->home = nodes[h];
+	}
     }
-  while (cln > 0);
+  return test_cpus_num * n;
 }
 
+/* rows are the cores (and their node), columns the node of the memory */
 static void
-store_0_eventually_nf(volatile cache_line_t* cl, volatile uint64_t reps)
+print_dram(const cell_t* cells, const cell_res_t* res, const int32_t* nodes, const uint32_t num_nodes)
 {
-  volatile uint32_t cln = 0;
-  do
+  PRINT(" ** memory latency: median (cycles per load) / rows: core (node) / columns: memory node");
+  uint32_t c, h;
+  printf("%11s", "");
+  for (h = 0; h < num_nodes; h++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(0);
-      w[0] = cln;
-      PFDO(0, reps);
+      printf(" %9d", nodes[h]);
     }
-  while (cln > 0);
-}
+  printf("\n");
 
-static void
-store_0_eventually_dw(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  volatile uint32_t cln = 0;
-  do
+  for (c = 0; c < test_cpus_num; c++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(0);
-      w[0] = cln;
-      w[16] = cln;
-      PFDO(0, reps);
+      printf("%5u (%3d)", test_cpus[c], topo_cpu_node(test_cpus[c]));
+      for (h = 0; h < num_nodes; h++)
+	{
+	  const cell_res_t* cr = res + (c * num_nodes) + h;
+	  if (cr->done)
+	    {
+	      printf(cr->flagged ? " %8.1f*" : " %9.1f", cr->median);
+	    }
+	  else
+	    {
+	      printf(" %9s", "-");
+	    }
+	}
+      printf("\n");
     }
-  while (cln > 0);
+  printf("\n");
 }
 
-void
-store_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps)
+/* the pairs of physical cores (the first SMT thread of each) of test_cpus for --saturate. */
+/* variant 0: the cores of every package in twos, package after package / variant 1: the */
+/* cores of the first package with the cores of the other packages. a and b get the cores */
+/* of the pairs, if not NULL */
+static uint32_t
+saturate_pairs(const uint32_t variant, uint32_t* a, uint32_t* b)
 {
-  if (test_sfence == 0)
-    {
-      store_0_eventually_nf(cl, reps);
-    }
-  else if (test_sfence == 1)
-    {
-      store_0_eventually_sf(cl, reps);
-    }
-  else if (test_sfence == 2)
+  uint32_t* cores = (uint32_t*) malloc(test_cpus_num * sizeof(uint32_t));
+  uint8_t* taken = (uint8_t*) calloc(test_cpus_num, sizeof(uint8_t));
+  assert(cores != NULL && taken != NULL);
+
+  uint32_t c, num_cores = 0;
+  for (c = 0; c < test_cpus_num; c++)
     {
-      store_0_eventually_mf(cl, reps);
+      if (core_key(test_cpus[c]) == (int32_t) test_cpus[c])
+	{
+	  cores[num_cores++] = test_cpus[c];
+	}
     }
-  else if (test_sfence == 3)
+
+  uint32_t i, j, n = 0;
+  int32_t first = (num_cores > 0) ? cpu_package(cores[0]) : 0;
+  for (i = 0; i < num_cores; i++)
     {
-      store_0_eventually_dw(cl, reps);
+      int same = (variant == 0);
+      if (taken[i] || (!same && cpu_package(cores[i]) != first))
+	{
+	  continue;
+	}
+      for (j = i + 1; j < num_cores; j++)
+	{
+	  if (!taken[j] && same == (cpu_package(cores[j]) == cpu_package(cores[i])))
+	    {
+	      break;
+	    }
+	}
+      if (j == num_cores)
+	{
+	  continue;
+	}
+      taken[i] = taken[j] = 1;
+      if (a != NULL)
+	{
+	  a[n] = cores[i];
+	  b[n] = cores[j];
+	}
+      n++;
     }
-  /* _mm_mfence(); */
-}
 
+  free(cores);
+  free(taken);
+  return n;
+}
 
-static void
-store_0_eventually_pfd1_sf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* for every variant and K = 1..num_pairs[variant]: the first K pairs (K-major) */
+static uint32_t
+saturate_cells(cell_t** cells, uint32_t* num_pairs)
 {
-  volatile uint32_t cln = 0;
-  do
+  uint32_t* a = (uint32_t*) malloc(test_cpus_num * sizeof(uint32_t));
+  uint32_t* b = (uint32_t*) malloc(test_cpus_num * sizeof(uint32_t));
+  *cells = (cell_t*) malloc((test_groups * (test_groups + 1) + 1) * sizeof(cell_t));
+  assert(a != NULL && b != NULL && *cells != NULL);
+
+  uint32_t v, k, p, n = 0;
+  for (v = 0; v < 2; v++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(1);
-      w[0] = cln;
-      _mm_sfence();
-      PFDO(1, reps);
+      num_pairs[v] = saturate_pairs(v, a, b);
+      for (k = 1; k <= num_pairs[v]; k++)
+	{
+	  for (p = 0; p < k; p++)
+	    {
+	      cell_t* cell = *cells + n++;
+	      cell->event = PING_PONG;
+	      cell->core[0] = a[p];
+	      cell->core[1] = cell->core[2] = b[p];
+	      cell->procs = 2;
+	      cell->corunner = -1;
+	      cell->home = -1;
+	    }
+	}
     }
-  while (cln > 0);
+
+  free(a);
+  free(b);
+  return n;
 }
 
+/* one round per variant and K, with the K pairs on groups 0..K-1. A round is skipped only if */
+/* all of its cells are done in skip (if not NULL), else it is measured again as a whole */
 static void
-store_0_eventually_pfd1_mf(volatile cache_line_t* cl, volatile uint64_t reps)
+saturate_schedule(schedule_t* sched, const cell_t* cells, const uint32_t* num_pairs, 
+		  const cell_res_t* skip)
 {
-  volatile uint32_t cln = 0;
-  do
+  uint32_t v, k, p, c = 0;
+  for (v = 0; v < 2; v++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(1);
-      w[0] = cln;
-      _mm_mfence();
-      PFDO(1, reps);
+      for (k = 1; k <= num_pairs[v]; c += k, k++)
+	{
+	  uint32_t done = 0;
+	  for (p = 0; p < k && skip != NULL; p++)
+	    {
+	      done += skip[c + p].done;
+	    }
+	  if (done == k)
+	    {
+	      continue;
+	    }
+
+	  uint32_t r = sched->rounds++;
+	  sched->cell = (int32_t*) realloc(sched->cell, sched->rounds * test_groups * sizeof(int32_t));
+	  sched->park = (uint32_t*) realloc(sched->park, sched->rounds * sizeof(uint32_t));
+	  assert(sched->cell != NULL && sched->park != NULL);
+
+	  int32_t* round = sched->cell + r * test_groups;
+	  uint32_t g;
+	  for (g = 0; g < test_groups; g++)
+	    {
+	      round[g] = (g < k) ? (int32_t) (c + g) : -1;
+	    }
+
+	  /* the idle groups wait on a core that is not in the round (if any) */
+	  sched->park[r] = test_cpus[0];
+	  uint32_t i;
+	  for (i = 0; i < test_cpus_num; i++)
+	    {
+	      int32_t key = core_key(test_cpus[i]);
+	      for (p = 0; p < k; p++)
+		{
+		  if (core_key(cells[c + p].core[0]) == key || core_key(cells[c + p].core[1]) == key)
+		    {
+		      break;
+		    }
+		}
+	      if (p == k)
+		{
+		  sched->park[r] = test_cpus[i];
+		  break;
+		}
+	    }
+	}
     }
-  while (cln > 0);
 }
 
-static void
-store_0_eventually_pfd1_nf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* the ticks of getticks per second, counted over TICK_RATE_NS */
+static double
+tick_rate()
 {
-  volatile uint32_t cln = 0;
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ticks t0 = getticks();
+  double ns;
   do
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      PFDI(1);
-      w[0] = cln;
-      PFDO(1, reps);
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      ns = (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
     }
-  while (cln > 0);
+  while (ns < TICK_RATE_NS);
+  ticks t1 = getticks();
+  return (t1 - t0) / (ns / 1e9);
 }
 
-void
-store_0_eventually_pfd1(volatile cache_line_t* cl, volatile uint64_t reps)
+/* for every variant and K: the median round trip (avg and worst over the pairs), its */
+/* inflation over K = 1, and the aggregate transfers/s (two per round trip) of the K pairs */
+static void
+print_saturate(const cell_t* cells, const cell_res_t* res, const uint32_t* num_pairs)
 {
-  if (test_sfence == 0)
-    {
-      store_0_eventually_pfd1_nf(cl, reps);
-    }
-  else if (test_sfence == 1)
-    {
-      store_0_eventually_pfd1_sf(cl, reps);
-    }
-  else if (test_sfence == 2)
+  static const char* variant_des[] = { "on the same package", "across packages" };
+  double rate = tick_rate();
+
+  uint32_t v, k, p, c = 0;
+  for (v = 0; v < 2; v++)
     {
-      store_0_eventually_pfd1_mf(cl, reps);
-    }
-  /* _mm_mfence(); */
-}
+      PRINT(" ** PING_PONG saturation: pairs %s (%u) / round trip: median (cycles) / %.2f GHz ticks", 
+	    variant_des[v], num_pairs[v], rate / 1e9);
+      if (num_pairs[v] == 0)
+	{
+	  printf("\n");
+	  continue;
+	}
+      printf("%4s %12s %12s %10s %14s\n", "K", "avg pair", "worst pair", "inflation", "Mtransfers/s");
 
-static uint64_t
-load_0_eventually_lf(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  volatile uint32_t cln = 0;
-  volatile uint64_t val = 0;
+      double base = 0;
+      for (k = 1; k <= num_pairs[v]; c += k, k++)
+	{
+	  double sum = 0, worst = 0, xfers = 0;
+	  uint32_t done = 0;
+	  for (p = 0; p < k; p++)
+	    {
+	      const cell_res_t* cr = res + c + p;
+	      if (!cr->done || cr->median <= 0)
+		{
+		  continue;
+		}
+	      sum += cr->median;
+	      worst = (cr->median > worst) ? cr->median : worst;
+	      xfers += 2 * rate / cr->median;
+	      done++;
+	    }
+	  if (done == 0)
+	    {
+	      printf("%4u %12s\n", k, "-");
+	      continue;
+	    }
 
-  do
-    {
-      cln = clrand();
-      volatile uint32_t* w = &cl[cln].word[0];
-      PFDI(0);
-      val = w[0];
-      _mm_lfence();
-      PFDO(0, reps);
+	  double avg = sum / done;
+	  if (k == 1)
+	    {
+	      base = avg;
+	    }
+	  printf("%4u %12.1f %12.1f %9.2fx %14.1f\n", k, avg, worst, (base > 0) ? avg / base : 0, 
+		 xfers / 1e6);
+	}
+      printf("\n");
     }
-  while (cln > 0);
-  return val;
 }
 
-static uint64_t
-load_0_eventually_mf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* one table per home node: rows are the owner node, columns the requester node */
+static void
+print_home(const cell_t* cells, const cell_res_t* res, const int32_t* nodes, const uint32_t num_nodes)
 {
-  volatile uint32_t cln = 0;
-  volatile uint64_t val = 0;
-
-  do
+  uint32_t h, o, q;
+  for (h = 0; h < num_nodes; h++)
     {
-      cln = clrand();
-      volatile uint32_t* w = &cl[cln].word[0];
-      PFDI(0);
-      val = w[0];
-      _mm_mfence();
-      PFDO(0, reps);
+      PRINT(" ** %s : median (cycles) / home node %d / rows: owner node / columns: requester node",
+	    moesi_type_des[test_test], nodes[h]);
+      printf("      ");
+      for (q = 0; q < num_nodes; q++)
+	{
+	  printf(" %8d", nodes[q]);
+	}
+      printf("\n");
+
+      for (o = 0; o < num_nodes; o++)
+	{
+	  printf("%6d", nodes[o]);
+	  for (q = 0; q < num_nodes; q++)
+	    {
+	      const cell_res_t* cr = res + (((h * num_nodes) + o) * num_nodes) + q;
+	      if (cr->done)
+		{
+		  printf(cr->flagged ? " %7.1f*" : " %8.1f", cr->median);
+		}
+	      else
+		{
+		  printf(" %8s", "-");
+		}
+	    }
+	  printf("\n");
+	}
+      printf("\n");
     }
-  while (cln > 0);
-  return val;
 }
 
-static uint64_t
-load_0_eventually_nf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* one table per event: rows are the owner class, columns the sharer class */
+static void
+print_sweep3(const cell_t* cells, const cell_res_t* res, const uint32_t num_cells)
 {
-  volatile uint32_t cln = 0;
-  volatile uint64_t val = 0;
-
-  do
+  uint32_t e, co, cs, c;
+  for (e = 0; e < THREE_PARTY_NUM; e++)
     {
-      cln = clrand();
-      volatile uint32_t* w = &cl[cln].word[0];
-      PFDI(0);
-      val = w[0];
-      PFDO(0, reps);
-    }
-  while (cln > 0);
-  return val;
-}
+      const three_party_t* tp = three_party + e;
+      for (c = 0; c < num_cells && cells[c].event != tp->event; c++)
+	;
+      if (c == num_cells)
+	{
+	  continue;
+	}
 
+      PRINT(" ** %s : median (cycles) of the requester on core %u / rows: owner class / "
+	    "columns: sharer class", moesi_type_des[tp->event], test_core1);
+      printf("%-16s", "");
+      for (cs = 0; cs < TOPO_NUM_CLASSES; cs++)
+	{
+	  printf(" %15s", topo_class_des[cs]);
+	}
+      printf("\n");
 
-uint64_t
-load_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  uint64_t val = 0;
-  if (test_lfence == 0)
-    {
-      val = load_0_eventually_nf(cl, reps);
-    }
-  else if (test_lfence == 1)
-    {
-      val = load_0_eventually_lf(cl, reps);
-    }
-  else if (test_lfence == 2)
-    {
-      val = load_0_eventually_mf(cl, reps);
+      for (co = 0; co < TOPO_NUM_CLASSES; co++)
+	{
+	  printf("%-16s", topo_class_des[co]);
+	  for (cs = 0; cs < TOPO_NUM_CLASSES; cs++)
+	    {
+	      const cell_res_t* cr = NULL;
+	      for (c = 0; c < num_cells; c++)
+		{
+		  const cell_t* cell = cells + c;
+		  if (cell->event == tp->event && res[c].done
+		      && topo_pair_class(test_core1, cell->core[tp->owner]) == co
+		      && topo_pair_class(test_core1, cell->core[tp->sharer]) == cs)
+		    {
+		      cr = res + c;
+		      break;
+		    }
+		}
+
+	      if (cr != NULL)
+		{
+		  printf(cr->flagged ? " %14.1f*" : " %15.1f", cr->median);
+		}
+	      else
+		{
+		  printf(" %15s", "-");
+		}
+	    }
+	  printf("\n");
+	}
+      printf("\n");
     }
-  _mm_mfence();
-  return val;
 }
 
-uint64_t
-load_0_eventually_no_pf(volatile cache_line_t* cl)
+#if defined(PFD_ASM)
+extern const pfd_region_t __start_pfd_regions[], __stop_pfd_regions[];
+
+/* the bytes of every timed region between the two rdtsc: the fixed prefix that keeps the */
+/* start ticks in rsi, then the body */
+#  define VERIFY_PREFIX "48 c1 e2 20 48 09 d0 48 89 c6"
+static const struct
 {
-  uint32_t cln = 0;
-  uint64_t sum = 0;
-  do
+  const char* name;
+  const char* bytes;
+} verify_bytes[] =
+  {
+    { "empty", "" },
+    { "load", "8b 0f" },
+    { "load lfence", "8b 0f 0f ae e8" },
+    { "load mfence", "8b 0f 0f ae f0" },
+    { "store", "89 0f" },
+    { "store sfence", "89 0f 0f ae f8" },
+    { "store mfence", "89 0f 0f ae f0" },
+    { "store2", "89 0f 89 4f 40" },
+    { "chase", "48 8b 3f 41 ff c8 75 f8" },
+    { "chase lfence", "48 8b 3f 0f ae e8 41 ff c8 75 f5" },
+    { "chase mfence", "48 8b 3f 0f ae f0 41 ff c8 75 f5" },
+    { "cas", "89 c8 f0 44 0f b1 07 89 c1" },
+    { "fai", "f0 0f c1 0f" },
+    { "tas", "86 0f" },
+    { "swap", "87 0f" },
+    { "clflush", "0f ae 3f" },
+    { "lfence", "0f ae e8" },
+    { "sfence", "0f ae f8" },
+    { "mfence", "0f ae f0" },
+    { "pause", "f3 90" },
+    { "nop", "90" },
+  };
+#endif	/* PFD_ASM */
+
+/* --verify-kernels: prints the timed region of every kernel instance in the binary and checks */
+/* that it is exactly rdtsc, the expected instructions, rdtsc. Returns the exit status */
+static int
+verify_kernels()
+{
+#if defined(PFD_ASM)
+  uint32_t num = 0, bad = 0;
+  const pfd_region_t* r;
+  for (r = __start_pfd_regions; r < __stop_pfd_regions; r++)
     {
-      cln = clrand();
-      volatile uint32_t *w = &cl[cln].word[0];
-      sum = w[0];
-    }
-  while (cln > 0);
+      char got[256] = "";
+      size_t len = 0;
+      const uint8_t* b;
+      for (b = r->start; b < r->end && len + 4 < sizeof(got); b++)
+	{
+	  len += snprintf(got + len, sizeof(got) - len, "%s%02x", len ? " " : "", *b);
+	}
 
-  _mm_mfence();
-  return sum;
-}
+      const char* exp = NULL;
+      uint32_t e;
+      for (e = 0; e < sizeof(verify_bytes) / sizeof(verify_bytes[0]); e++)
+	{
+	  if (!strcmp(verify_bytes[e].name, r->name))
+	    {
+	      exp = verify_bytes[e].bytes;
+	    }
+	}
 
-static uint64_t
-load_0_lf(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  volatile uint32_t val = 0;
-  volatile uint32_t* p = (volatile uint32_t*) &cl->word[0];
-  PFDI(0);
-  val = p[0];
-  _mm_lfence();
-  PFDO(0, reps);
-  return val;
-}
+      char want[256];
+      snprintf(want, sizeof(want), "%s%s%s", VERIFY_PREFIX, (exp != NULL && *exp) ? " " : "", 
+	       exp != NULL ? exp : "");
+      int ok = exp != NULL && !strcmp(got, want)
+	&& r->start[-2] == 0x0f && r->start[-1] == 0x31 && r->end[0] == 0x0f && r->end[1] == 0x31;
+      bad += !ok;
+      num++;
+      printf("%-14s %p %3u bytes  %-62s %s\n", r->name, (void*) r->start, (uint32_t) (r->end - r->start), 
+	     got, ok ? "ok" : "MISMATCH");
+    }
 
-static uint64_t
-load_0_mf(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  volatile uint32_t val = 0;
-  volatile uint32_t* p = (volatile uint32_t*) &cl->word[0];
-  PFDI(0);
-  val = p[0];
-  _mm_mfence();
-  PFDO(0, reps);
-  return val;
+  printf("* %u timed regions, %u mismatched\n", num, bad);
+  return (bad > 0 || num == 0);
+#else
+  printf("* the timed regions are C on this architecture (PFDI, op, PFDO): nothing to verify\n");
+  return 0;
+#endif	/* PFD_ASM */
 }
 
-static uint64_t
-load_0_nf(volatile cache_line_t* cl, volatile uint64_t reps)
+/* --pattern <name>[:<decoys>]: -1 if s is not one */
+static int
+pattern_parse(const char* s)
 {
-  volatile uint32_t val = 0;
-  volatile uint32_t* p = (volatile uint32_t*) &cl->word[0];
-  PFDI(0);
-  val = p[0];
-  PFDO(0, reps);
-  return val;
-}
-
+  const char* colon = strchr(s, ':');
+  const size_t len = (colon != NULL) ? (size_t) (colon++ - s) : strlen(s);
 
-uint64_t
-load_0(volatile cache_line_t* cl, volatile uint64_t reps)
-{
-  uint64_t val = 0;
-  if (test_lfence == 0)
-    {
-      val = load_0_nf(cl, reps);
-    }
-  else if (test_lfence == 1)
+  uint32_t p;
+  for (p = 0; p < ACCESS_NUM_PATTERNS; p++)
     {
-      val = load_0_lf(cl, reps);
+      if (!strncmp(s, access_pattern_des[p], len) && access_pattern_des[p][len] == '\0')
+	{
+	  break;
+	}
     }
-  else if (test_lfence == 2)
+  if (p == ACCESS_NUM_PATTERNS)
     {
-      val = load_0_mf(cl, reps);
+      return -1;
     }
-  _mm_mfence();
-  return val;
-}
+  test_pattern = p;
 
-static uint64_t
-load_next_lf(volatile uint64_t* cl, volatile uint64_t reps)
-{
-  const size_t do_reps = test_cache_line_num;
-  PFDI(0);
-  int i;
-  for (i = 0; i < do_reps; i++)
+  if (p == ACCESS_NONE)
     {
-      cl = (uint64_t*) *cl;
-      _mm_lfence();
+      test_decoys = 0;
+      return (colon == NULL) ? 0 : -1;
     }
-  PFDOR(0, reps, do_reps);
-  return *cl;
-
-}
-
-static uint64_t
-load_next_mf(volatile uint64_t* cl, volatile uint64_t reps)
-{
-  const size_t do_reps = test_cache_line_num;
-  PFDI(0);
-  int i;
-  for (i = 0; i < do_reps; i++)
+  if (colon != NULL)
     {
-      cl = (uint64_t*) *cl;
-      _mm_mfence();
+      char* end;
+      long d = strtol(colon, &end, 10);
+      if (*colon == '\0' || *end != '\0' || d < 0 || d > ACCESS_DECOYS_MAX)
+	{
+	  return -1;
+	}
+      test_decoys = d;
     }
-  PFDOR(0, reps, do_reps);
-  return *cl;
-
+  return 0;
 }
 
-static uint64_t
-load_next_nf(volatile uint64_t* cl, volatile uint64_t reps)
+/* PING_PONG: ID 0 hands the line to ID 1 and waits for it to come back, PING_PONG_ROUNDS */
+/* times. The values keep increasing over the repetitions, so no reset is needed in between */
+static void
+ping_pong_0(volatile cache_line_t* cl, volatile uint64_t reps)
 {
-  const size_t do_reps = test_cache_line_num;
+  volatile uint32_t* w = &cl->word[0];
+  uint32_t seq = reps * 2 * PING_PONG_ROUNDS;
+  uint32_t i;
   PFDI(0);
-  int i;
-  for (i = 0; i < do_reps; i++)
+  for (i = 0; i < PING_PONG_ROUNDS; i++)
     {
-      cl = (uint64_t*) *cl;
+      *w = ++seq;
+      seq++;
+      while (*w != seq)
+	{
+	  PAUSE();
+	}
     }
-  PFDOR(0, reps, do_reps);
-  return *cl;
+  PFDOR(0, reps, PING_PONG_ROUNDS);
 }
 
-uint64_t
-load_next(volatile uint64_t* cl, volatile uint64_t reps)
+static void
+ping_pong_1(volatile cache_line_t* cl, volatile uint64_t reps)
 {
-  uint64_t val = 0;
-  if (test_lfence == 0)
-    {
-      val = load_next_nf(cl, reps);
-    }
-  else if (test_lfence == 1)
+  volatile uint32_t* w = &cl->word[0];
+  uint32_t seq = reps * 2 * PING_PONG_ROUNDS;
+  uint32_t i;
+  for (i = 0; i < PING_PONG_ROUNDS; i++)
     {
-      val = load_next_lf(cl, reps);
-    }
-  else if (test_lfence == 2)
-    {
-      val = load_next_mf(cl, reps);
+      seq++;
+      while (*w != seq)
+	{
+	  PAUSE();
+	}
+      *w = ++seq;
     }
-  return val;
-}
-
-void
-invalidate(volatile cache_line_t* cl, uint64_t index, volatile uint64_t reps)
-{
-  PFDI(0);
-  _mm_clflush((void*) (cl + index));
-  PFDO(0, reps);
-  _mm_mfence();
 }
 
 static size_t
@@ -2025,40 +4507,60 @@ cache_line_open()
   cache_line->word[0] = 0;
 
 #else	 /* !__tile__ ****************************************************************************************/
-  char keyF[100];
-  sprintf(keyF, CACHE_LINE_MEM_FILE);
-
-  int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
-  if (ssmpfd < 0) 
+  volatile cache_line_t* cache_line;
+  if (test_threads)
     {
-      if (errno != EEXIST) 
+      /* one address space: no named object to create, size, or clean up after a crash */
+      cache_line = (volatile cache_line_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, 
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (cache_line == MAP_FAILED)
 	{
-	  perror("In shm_open");
-	  exit(1);
+	  perror("cache_line mmap");
+	  exit(134);
 	}
+    }
+  else
+    {
+      char keyF[100];
+      sprintf(keyF, CACHE_LINE_MEM_FILE);
 
-
-      ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
+      int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
       if (ssmpfd < 0) 
 	{
-	  perror("In shm_open");
+	  if (errno != EEXIST) 
+	    {
+	      perror("In shm_open");
+	      exit(1);
+	    }
+
+
+	  ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
+	  if (ssmpfd < 0) 
+	    {
+	      perror("In shm_open");
+	      exit(1);
+	    }
+	}
+      else {
+	//    P("%s newly openned", keyF);
+	if (ftruncate(ssmpfd, size) < 0) {
+	  perror("ftruncate failed\n");
 	  exit(1);
 	}
+      }
+
+      cache_line = 
+	(volatile cache_line_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
+      if (cache_line == NULL)
+	{
+	  perror("cache_line = NULL\n");
+	  exit(134);
+	}
     }
-  else {
-    //    P("%s newly openned", keyF);
-    if (ftruncate(ssmpfd, size) < 0) {
-      perror("ftruncate failed\n");
-      exit(1);
-    }
-  }
 
-  volatile cache_line_t* cache_line = 
-    (volatile cache_line_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
-  if (cache_line == NULL)
+  if (test_mem_node >= 0)
     {
-      perror("cache_line = NULL\n");
-      exit(134);
+      topo_mem_bind(cache_line, size, test_mem_node);
     }
 
 #endif  /* __tile ********************************************************************************************/
@@ -2066,14 +4568,9 @@ cache_line_open()
 
   if (ID == 0)
     {
-      uint32_t cl;
-      for (cl = 0; cl < test_cache_line_num; cl++)
-	{
-	  cache_line[cl].word[0] = 0;
-	  _mm_clflush((void*) (cache_line + cl));
-	}
+      cache_line_reset(cache_line, test_cache_line_num);
 
-      if (test_test == LOAD_FROM_MEM_SIZE)
+      if (test_test == LOAD_FROM_MEM_SIZE && !test_dram) /* --dram: one list per node, in main */
 	{
 	  create_rand_list_cl((volatile uint64_t*) cache_line, test_mem_size / sizeof(uint64_t));
 	}
@@ -2085,13 +4582,26 @@ cache_line_open()
   return cache_line;
 }
 
+/* brings the first num_lines cache lines to their initial state: value 0, not cached */
+static void
+cache_line_reset(volatile cache_line_t* cache_line, const uint32_t num_lines)
+{
+  uint32_t cl;
+  for (cl = 0; cl < num_lines; cl++)
+    {
+      cache_line[cl].word[0] = 0;
+      cpu_flush(cache_line + cl);
+    }
+  _mm_mfence();
+}
+
 static void
 create_rand_list_cl(volatile uint64_t* list, size_t n)
 {
   size_t per_cl = sizeof(cache_line_t) / sizeof(uint64_t);
   n /= per_cl;
 
-  unsigned long* s = seed_rand();
+  unsigned long* s = seed_rand(0, 0);
   s[0] = 0xB9E4E2F1F1E2E3D5L;
   s[1] = 0xF1E2E3D5B9E4E2F1L;
   s[2] = 0x9B3A0FA212342345L;
@@ -2126,7 +4636,7 @@ void
 cache_line_close(const uint32_t id, const char* name)
 {
 #if !defined(__tile__)
-  if (id == 0)
+  if (id == 0 && !test_threads)
     {
       char keyF[100];
       sprintf(keyF, CACHE_LINE_MEM_FILE);
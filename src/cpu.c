@@ -0,0 +1,298 @@
+/*
+ *   File: cpu.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: runtime detection of the processor and of its features (CPUID, auxv)
+ *   cpu.c is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "cpu.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <cpuid.h>
+#elif defined(__linux__)
+#  include <sys/auxv.h>
+#endif
+
+const char* cpu_platform_des[] =
+  {
+    "default",
+    "opteron",
+    "opteron2",
+    "xeon",
+    "niagara",
+    "tilera",
+  };
+
+const char* cpu_feature_des[] =
+  {
+    "rdtscp",
+    "invariant_tsc",
+    "clflush",
+    "clflushopt",
+    "clwb",
+    "prefetchw",
+    "cmpxchg16b",
+    "fences",
+    "pause",
+    "avx",
+    "avx2",
+    "avx512",
+  };
+
+/* the pfd corrections that used to be set per host, now per detected platform */
+static const double cpu_pfd_correction[] =
+  {
+    0,				/* DEFAULT */
+    64,				/* OPTERON */
+    68,				/* OPTERON2 */
+    20,				/* XEON */
+    76,				/* NIAGARA */
+    0,				/* TILERA */
+  };
+
+static cpu_info_t cpu_info;
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint64_t
+cpu_xgetbv()
+{
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* the CPUID leaves: 1 (family, clflush, sse2, cmpxchg16b, avx), 7 (avx2, avx512f, clflushopt, */
+/* clwb), 0x80000001 (prefetchw, rdtscp), 0x80000002-4 (brand), 0x80000007 (invariant tsc) */
+static void
+cpu_detect()
+{
+  uint32_t a, b, c, d;
+  uint32_t max = __get_cpuid_max(0, NULL);
+  if (max == 0)
+    {
+      return;
+    }
+
+  __cpuid(0, a, b, c, d);
+  memcpy(cpu_info.vendor, &b, 4);
+  memcpy(cpu_info.vendor + 4, &d, 4);
+  memcpy(cpu_info.vendor + 8, &c, 4);
+  cpu_info.vendor[12] = '\0';
+
+  __cpuid(1, a, b, c, d);
+  cpu_info.family = (a >> 8) & 0xF;
+  cpu_info.model = (a >> 4) & 0xF;
+  if (cpu_info.family == 0xF)
+    {
+      cpu_info.family += (a >> 20) & 0xFF;
+    }
+  if (cpu_info.family >= 0x6)
+    {
+      cpu_info.model |= ((a >> 16) & 0xF) << 4;
+    }
+
+  if (d & (1 << 19))
+    {
+      cpu_info.features |= CPU_CLFLUSH;
+    }
+  if (d & (1 << 26))
+    {
+      cpu_info.features |= CPU_FENCES | CPU_PAUSE;
+    }
+  if (c & (1 << 13))
+    {
+      cpu_info.features |= CPU_CMPXCHG16B;
+    }
+  uint64_t xcr0 = (c & (1 << 27)) ? cpu_xgetbv() : 0;
+  if ((c & (1 << 28)) && (xcr0 & 0x6) == 0x6)
+    {
+      cpu_info.features |= CPU_AVX;
+    }
+
+  if (max >= 7)
+    {
+      __cpuid_count(7, 0, a, b, c, d);
+      if ((cpu_info.features & CPU_AVX) && (b & (1 << 5)))
+	{
+	  cpu_info.features |= CPU_AVX2;
+	}
+      if ((b & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+	{
+	  cpu_info.features |= CPU_AVX512;
+	}
+      if (b & (1 << 23))
+	{
+	  cpu_info.features |= CPU_CLFLUSHOPT;
+	}
+      if (b & (1 << 24))
+	{
+	  cpu_info.features |= CPU_CLWB;
+	}
+    }
+
+  uint32_t ext = __get_cpuid_max(0x80000000, NULL);
+  if (ext >= 0x80000001)
+    {
+      __cpuid(0x80000001, a, b, c, d);
+      if (c & (1 << 8))
+	{
+	  cpu_info.features |= CPU_PREFETCHW;
+	}
+      if (d & (1 << 27))
+	{
+	  cpu_info.features |= CPU_RDTSCP;
+	}
+    }
+  if (ext >= 0x80000004)
+    {
+      uint32_t* brand = (uint32_t*) cpu_info.brand;
+      __cpuid(0x80000002, brand[0], brand[1], brand[2], brand[3]);
+      __cpuid(0x80000003, brand[4], brand[5], brand[6], brand[7]);
+      __cpuid(0x80000004, brand[8], brand[9], brand[10], brand[11]);
+      cpu_info.brand[48] = '\0';
+      size_t lead = strspn(cpu_info.brand, " ");
+      memmove(cpu_info.brand, cpu_info.brand + lead, sizeof(cpu_info.brand) - lead);
+    }
+  if (ext >= 0x80000007)
+    {
+      __cpuid(0x80000007, a, b, c, d);
+      if (d & (1 << 8))
+	{
+	  cpu_info.features |= CPU_INVARIANT_TSC;
+	}
+    }
+
+  if (!strcmp(cpu_info.vendor, "AuthenticAMD"))
+    {
+      cpu_info.platform = (cpu_info.family == 0x10) ? CPU_OPTERON
+	: (cpu_info.family >= 0x15) ? CPU_OPTERON2 : CPU_DEFAULT;
+    }
+  else if (!strcmp(cpu_info.vendor, "GenuineIntel"))
+    {
+      cpu_info.platform = CPU_XEON;
+    }
+}
+#else
+static void
+cpu_detect()
+{
+#  if defined(__linux__)
+  const char* plat = (const char*) getauxval(AT_PLATFORM);
+  if (plat != NULL)
+    {
+      snprintf(cpu_info.vendor, sizeof(cpu_info.vendor), "%s", plat);
+    }
+#  endif
+
+#  if defined(__sparc__)
+  /* membar and the rd %ccr pause; no user-level flush of a line */
+  cpu_info.features |= CPU_FENCES | CPU_PAUSE;
+  if (!strncmp(cpu_info.vendor, "sun4v", 5))
+    {
+      cpu_info.platform = CPU_NIAGARA;
+    }
+#  elif defined(__tile__)
+  cpu_info.features |= CPU_CLFLUSH | CPU_FENCES | CPU_PAUSE;
+  cpu_info.platform = CPU_TILERA;
+#  endif
+}
+#endif	/* x86 */
+
+/* detects the processor once, before the options are parsed */
+void
+cpu_init()
+{
+  memset(&cpu_info, 0, sizeof(cpu_info_t));
+  cpu_detect();
+  cpu_info.vector_bits = (cpu_info.features & CPU_AVX512) ? 512 
+    : (cpu_info.features & CPU_AVX) ? 256 : 128;
+  cpu_info.pfd_correction = cpu_pfd_correction[cpu_info.platform];
+  cpu_info.spin_up = (cpu_info.platform != CPU_OPTERON && cpu_info.platform != CPU_NIAGARA 
+		      && cpu_info.platform != CPU_TILERA);
+}
+
+const cpu_info_t*
+cpu_get()
+{
+  return &cpu_info;
+}
+
+/* are all of the features available? */
+int
+cpu_has(const uint32_t features)
+{
+  return (cpu_info.features & features) == features;
+}
+
+/* the names of the features, space separated */
+void
+cpu_features_str(const uint32_t features, char* buf, const size_t len)
+{
+  size_t n = 0;
+  uint32_t f;
+  buf[0] = '\0';
+  for (f = 0; f < CPU_NUM_FEATURES && n < len; f++)
+    {
+      if (features & (1 << f))
+	{
+	  n += snprintf(buf + n, len - n, "%s%s", n ? " " : "", cpu_feature_des[f]);
+	}
+    }
+}
+
+void
+cpu_print()
+{
+  char feats[256];
+  cpu_features_str(cpu_info.features, feats, sizeof(feats));
+  printf("cpu:     %s %s / family 0x%x model 0x%x / platform: %s / vectors: %u bits\n", 
+	 cpu_info.vendor, cpu_info.brand, cpu_info.family, cpu_info.model, 
+	 cpu_platform_des[cpu_info.platform], cpu_info.vector_bits);
+  printf("         features: %s\n", feats);
+}
+
+/* flushes the line of p out of the caches (untimed), with clflushopt if there is one. The */
+/* caller fences */
+void
+cpu_flush(volatile void* p)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if (cpu_info.features & CPU_CLFLUSHOPT)
+    {
+      /* clflushopt is 66 + clflush */
+      __asm__ __volatile__ (".byte 0x66; clflush %0" : "+m" (*(volatile char*) p));
+      return;
+    }
+  if (cpu_info.features & CPU_CLFLUSH)
+    {
+      __asm__ __volatile__ ("clflush %0" : "+m" (*(volatile char*) p));
+    }
+#elif defined(__tile__)
+  tmc_mem_finv_no_fence((const void*) p, 64);
+#else
+  (void) p;
+#endif
+}
@@ -0,0 +1,381 @@
+/*
+ *   File: kernels.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the timed kernels and their access sequences, shared by ccbench and libccbench
+ *   kernels.c is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "kernels.h"
+#include <assert.h>
+
+__thread uint32_t* access_seq;
+__thread uint32_t access_rows;
+__thread uint32_t access_decoys;
+static __thread size_t access_size;
+
+store_kernel_t store_0, store_0_no_pf, store_0_eventually, store_0_eventually_pfd1;
+load_kernel_t load_0, load_0_eventually;
+chase_kernel_t load_next;
+
+uint32_t
+cas(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  uint8_t o = reps & 0x1;
+  uint8_t no = !o; 
+  volatile uint64_t r = o;
+
+  PFDT(0, reps, "cas", PFD_ASM_CAS, r = CAS_U32(cl->word, o, no), r, cl->word, no);
+
+  return (r == o);
+}
+
+uint32_t
+cas_no_pf(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  uint8_t o = reps & 0x1;
+  uint8_t no = !o; 
+  volatile uint32_t r;
+  r = CAS_U32(cl->word, o, no);
+
+  return (r == o);
+}
+
+uint32_t
+cas_0_eventually(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  uint8_t o = reps & 0x1;
+  uint8_t no = !o; 
+  volatile uint64_t r;
+
+  const uint32_t* row = ACCESS_ROW(reps);
+  uint32_t a;
+  for (a = 0; a <= access_decoys; a++)
+    {
+      volatile cache_line_t* cl1 = cl + row[a];
+      r = o;
+      PFDT(0, reps, "cas", PFD_ASM_CAS, r = CAS_U32(cl1->word, o, no), r, cl1->word, no);
+    }
+
+  return (r == o);
+}
+
+uint32_t
+fai(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  volatile uint64_t t = 0;
+
+  const uint32_t* row = ACCESS_ROW(reps);
+  uint32_t a;
+  for (a = 0; a <= access_decoys; a++)
+    {
+      volatile cache_line_t* cl1 = cl + row[a];
+      t = 1;
+      PFDT(0, reps, "fai", PFD_ASM_FAI, t = FAI_U32(cl1->word), t, cl1->word, 0);
+    }
+
+  return t;
+}
+
+uint8_t
+tas(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  volatile uint64_t r;
+
+  const uint32_t* row = ACCESS_ROW(reps);
+  uint32_t a;
+  for (a = 0; a <= access_decoys; a++)
+    {
+      volatile cache_line_t* cl1 = cl + row[a];
+#if defined(__tile__)
+      volatile uint32_t* b = (volatile uint32_t*) cl1->word;
+#else
+      volatile uint8_t* b = (volatile uint8_t*) cl1->word;
+#endif
+
+      r = 0xFF;
+      PFDT(0, reps, "tas", PFD_ASM_TAS, r = TAS_U8(b), r, b, 0);
+    }
+
+  return (r != 255);
+}
+
+uint32_t
+swap(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  volatile uint64_t res;
+
+  const uint32_t* row = ACCESS_ROW(reps);
+  uint32_t a;
+  for (a = 0; a <= access_decoys; a++)
+    {
+      volatile cache_line_t* cl1 = cl + row[a];
+      res = ID;
+      PFDT(0, reps, "swap", PFD_ASM_SWAP, res = SWAP_U32(cl1->word, ID), res, cl1->word, 0);
+    }
+
+  _mm_mfence();
+  return res;
+}
+
+/* the fenced kernels are generated at compile time, one instance for every fence flavour: */
+/* NF no fence, LF load, SF store, MF full fence, and DW the double write of --fence 9. */
+/* The fence of an instance is a constant, so no timed loop branches on test_[ls]fence. */
+/* The timed regions are PFDT ones: a C op, and its fixed asm body with the name of the region */
+#define FENCE_NF()
+#define FENCE_LF() _mm_lfence()
+#define FENCE_SF() _mm_sfence()
+#define FENCE_MF() _mm_mfence()
+#define FENCE_ASM_NF ""
+#define FENCE_ASM_LF PFD_ASM_LFENCE
+#define FENCE_ASM_SF PFD_ASM_SFENCE
+#define FENCE_ASM_MF PFD_ASM_MFENCE
+#define FENCE_NAME_NF ""
+#define FENCE_NAME_LF " lfence"
+#define FENCE_NAME_SF " sfence"
+#define FENCE_NAME_MF " mfence"
+
+/* a store to word 0 of the line, or to word 0 of the line and of the next one (DW) */
+#define STORE_W(w, val) w[0] = val
+#define STORE_DW(w, val) w[0] = val; w[16] = val
+#define STORE_ASM_W PFD_ASM_STORE
+#define STORE_ASM_DW PFD_ASM_STORE2
+#define STORE_NAME_W "store"
+#define STORE_NAME_DW "store2"
+
+#define KERNEL_STORE_0(name, S, F, pfd)					\
+  static void								\
+  name(volatile cache_line_t* cl, volatile uint64_t reps)		\
+  {									\
+    volatile uint32_t* w = &cl->word[0];				\
+    uint64_t v = reps;							\
+    PFDT(pfd, reps, STORE_NAME_##S FENCE_NAME_##F, STORE_ASM_##S FENCE_ASM_##F, \
+	 STORE_##S(w, reps); FENCE_##F(), v, w, 0);			\
+  }
+
+#define KERNEL_STORE_0_NO_PF(name, S, F, pfd)			\
+  static void							\
+  name(volatile cache_line_t* cl, volatile uint64_t reps)	\
+  {								\
+    volatile uint32_t* w = &cl->word[0];			\
+    STORE_##S(w, reps);						\
+    FENCE_##F();						\
+  }
+
+#define KERNEL_STORE_0_EVENTUALLY(name, S, F, pfd)			\
+  static void								\
+  name(volatile cache_line_t* cl, volatile uint64_t reps)		\
+  {									\
+    const uint32_t* row = ACCESS_ROW(reps);				\
+    uint32_t a;								\
+    for (a = 0; a <= access_decoys; a++)					\
+      {									\
+	volatile uint32_t cln = row[a];					\
+	volatile uint32_t* w = &cl[cln].word[0];			\
+	uint64_t v = cln;						\
+	PFDT(pfd, reps, STORE_NAME_##S FENCE_NAME_##F, STORE_ASM_##S FENCE_ASM_##F, \
+	     STORE_##S(w, cln); FENCE_##F(), v, w, 0);			\
+      }									\
+  }
+
+#define KERNEL_LOAD_0(name, F)						\
+  static uint64_t							\
+  name(volatile cache_line_t* cl, volatile uint64_t reps)		\
+  {									\
+    volatile uint64_t val = 0;						\
+    volatile uint32_t* p = &cl->word[0];				\
+    PFDT(0, reps, "load" FENCE_NAME_##F, PFD_ASM_LOAD FENCE_ASM_##F,	\
+	 val = p[0]; FENCE_##F(), val, p, 0);				\
+    _mm_mfence();							\
+    return val;								\
+  }
+
+#define KERNEL_LOAD_0_EVENTUALLY(name, F)				\
+  static uint64_t							\
+  name(volatile cache_line_t* cl, volatile uint64_t reps)		\
+  {									\
+    const uint32_t* row = ACCESS_ROW(reps);				\
+    volatile uint64_t val = 0;						\
+    uint32_t a;								\
+    for (a = 0; a <= access_decoys; a++)					\
+      {									\
+	volatile uint32_t* w = &cl[row[a]].word[0];			\
+	PFDT(0, reps, "load" FENCE_NAME_##F, PFD_ASM_LOAD FENCE_ASM_##F, \
+	     val = w[0]; FENCE_##F(), val, w, 0);			\
+      }									\
+    _mm_mfence();							\
+    return val;								\
+  }
+
+/* the chase walks test_group_lines pointers per repetition; PFDTR reports a single hop */
+#define KERNEL_LOAD_NEXT(name, F)					\
+  static uint64_t							\
+  name(volatile uint64_t* cl, volatile uint64_t reps)			\
+  {									\
+    const size_t do_reps = test_group_lines;				\
+    volatile uint64_t* p = cl;						\
+    uint64_t v = 0;							\
+    PFDTR(0, reps, do_reps, "chase" FENCE_NAME_##F, PFD_ASM_CHASE(FENCE_ASM_##F), \
+	  size_t i; for (i = 0; i < do_reps; i++)			\
+	    {								\
+	      p = (uint64_t*) *p;					\
+	      FENCE_##F();						\
+	    }, v, cl, do_reps);						\
+    return *p + v;							\
+  }
+
+/* the instances of a store kernel and their table, indexed by test_sfence */
+#define STORE_KERNELS(KERNEL, name, pfd)			\
+  KERNEL(name##_nf, W, NF, pfd)					\
+  KERNEL(name##_sf, W, SF, pfd)					\
+  KERNEL(name##_mf, W, MF, pfd)					\
+  KERNEL(name##_dw, DW, NF, pfd)				\
+  static const store_kernel_t name##_kernels[] =		\
+    { name##_nf, name##_sf, name##_mf, name##_dw };
+
+/* the instances of a load kernel and their table, indexed by test_lfence */
+#define LOAD_KERNELS(KERNEL, name, kernel_t)			\
+  KERNEL(name##_nf, NF)						\
+  KERNEL(name##_lf, LF)						\
+  KERNEL(name##_mf, MF)						\
+  static const kernel_t name##_kernels[] =			\
+    { name##_nf, name##_lf, name##_mf };
+
+STORE_KERNELS(KERNEL_STORE_0, k_store_0, 0)
+STORE_KERNELS(KERNEL_STORE_0_NO_PF, k_store_0_no_pf, 0)
+STORE_KERNELS(KERNEL_STORE_0_EVENTUALLY, k_store_0_eventually, 0)
+STORE_KERNELS(KERNEL_STORE_0_EVENTUALLY, k_store_0_eventually_pfd1, 1)
+LOAD_KERNELS(KERNEL_LOAD_0, k_load_0, load_kernel_t)
+LOAD_KERNELS(KERNEL_LOAD_0_EVENTUALLY, k_load_0_eventually, load_kernel_t)
+LOAD_KERNELS(KERNEL_LOAD_NEXT, k_load_next, chase_kernel_t)
+
+/* points the fenced kernels to the instances of test_lfence / test_sfence */
+void
+kernels_select()
+{
+  store_0 = k_store_0_kernels[test_sfence];
+  store_0_no_pf = k_store_0_no_pf_kernels[test_sfence];
+  store_0_eventually = k_store_0_eventually_kernels[test_sfence];
+  store_0_eventually_pfd1 = k_store_0_eventually_pfd1_kernels[test_sfence];
+  load_0 = k_load_0_kernels[test_lfence];
+  load_0_eventually = k_load_0_eventually_kernels[test_lfence];
+  load_next = k_load_next_kernels[test_lfence];
+}
+
+uint64_t
+load_0_eventually_no_pf(volatile cache_line_t* cl, volatile uint64_t reps)
+{
+  const uint32_t* row = ACCESS_ROW(reps);
+  uint64_t sum = 0;
+  uint32_t a;
+  for (a = 0; a <= access_decoys; a++)
+    {
+      volatile uint32_t *w = &cl[row[a]].word[0];
+      sum = w[0];
+    }
+
+  _mm_mfence();
+  return sum;
+}
+
+void
+invalidate(volatile cache_line_t* cl, uint64_t index, volatile uint64_t reps)
+{
+  uint64_t v = 0;
+  PFDT(0, reps, "clflush", PFD_ASM_CLFLUSH, _mm_clflush((void*) (cl + index)), v, cl + index, 0);
+  _mm_mfence();
+}
+
+/* the decoys of --pattern that a stride has room for: none with a single line, and at most */
+/* the stride - 1 other lines when they must be distinct */
+uint32_t
+decoys_fit(const uint32_t stride)
+{
+  if (stride < 2)
+    {
+      return 0;
+    }
+  if (test_pattern == ACCESS_SHUFFLE && test_decoys >= stride)
+    {
+      return stride - 1;
+    }
+  return test_decoys;
+}
+
+/* draws the access sequences of the *_eventually kernels from the stream of the process, */
+/* before the timed repetitions: a row per repetition (up to ACCESS_ROWS, then they repeat), */
+/* each access_decoys lines of [1, stride) in the order of the pattern, and then line 0. */
+/* The stride can change between runs (--server, --batch), so the decoys follow it */
+void
+access_init()
+{
+  access_decoys = decoys_fit(test_stride);
+  const uint32_t width = access_decoys + 1;
+  const uint32_t rows = (test_reps == 0) ? 1 : (test_reps < ACCESS_ROWS) ? test_reps : ACCESS_ROWS;
+  const size_t size = (size_t) rows * width;
+  if (access_size != size)
+    {
+      free(access_seq);
+      access_seq = (uint32_t*) malloc(size * sizeof(uint32_t));
+      assert(access_seq != NULL);
+      access_size = size;
+    }
+  access_rows = rows;
+
+  const uint32_t lines = test_stride - 1;
+  uint32_t* perm = NULL;
+  uint32_t l, r, a;
+  if (test_pattern == ACCESS_SHUFFLE && access_decoys > 0)
+    {
+      perm = (uint32_t*) malloc(lines * sizeof(uint32_t));
+      assert(perm != NULL);
+      for (l = 0; l < lines; l++)
+	{
+	  perm[l] = l + 1;
+	}
+    }
+
+  for (r = 0; r < rows; r++)
+    {
+      uint32_t* row = access_seq + r * width;
+      for (a = 0; a < access_decoys; a++)
+	{
+	  const unsigned long x = my_random(seeds, seeds + 1, seeds + 2);
+	  if (perm != NULL)	/* partial Fisher-Yates: distinct lines */
+	    {
+	      const uint32_t j = a + x % (lines - a);
+	      const uint32_t t = perm[a];
+	      perm[a] = perm[j];
+	      perm[j] = t;
+	      row[a] = perm[a];
+	    }
+	  else
+	    {
+	      row[a] = 1 + x % lines;
+	    }
+	}
+      row[access_decoys] = 0;
+    }
+  free(perm);
+}
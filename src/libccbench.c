@@ -0,0 +1,416 @@
+/*
+ *   File: libccbench.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: libccbench, the sessions of pinned threads that run and time the operations
+ *   libccbench.c is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "libccbench.h"
+#include "common.h"
+#include "atomic_ops.h"
+#include "barrier.h"
+#include "pfd.h"
+#include "kernels.h"
+
+#define CCB_STRIDE 2048		/* the lines of a session: line 0 and the decoys of the kernels */
+#define CCB_SEED 0		/* the seed of the access sequences, the same in every session */
+#define CCB_POLL_US 50		/* the idle workers check for a new command this often */
+
+/* the pfd timing and the barriers are per thread, by ID */
+__thread uint32_t ID;
+__thread unsigned long* seeds;
+
+/* the parameters of the kernels of ccbench (kernels.h): its defaults, without fences */
+uint32_t test_reps = 1;
+uint32_t test_stride = CCB_STRIDE;
+uint32_t test_group_lines = CCB_STRIDE;
+uint32_t test_lfence = 0;
+uint32_t test_sfence = 0;
+access_pattern_t test_pattern = DEFAULT_PATTERN;
+uint32_t test_decoys = DEFAULT_DECOYS;
+
+typedef struct ccb_worker
+{
+  ccb_session_t* session;
+  uint32_t id;
+  uint32_t core;
+  pthread_t thread;
+} ccb_worker_t;
+
+struct ccb_session
+{
+  uint32_t num_cores;
+  uint32_t max_reps;
+  cache_line_t* lines;
+  ccb_worker_t* workers;
+  volatile uint32_t ready;	/* workers that are pinned and calibrated */
+  volatile uint32_t failed;	/* workers that could not pin themselves */
+  /* the command: workers run it when seq changes, cores[0] acks it in done */
+  volatile uint32_t seq;
+  volatile uint32_t done;
+  volatile uint32_t quit;
+  ccb_state_t state;
+  ccb_op_t op;
+  uint32_t reps;
+  ccb_stats_t stats;
+};
+
+static volatile uint32_t ccb_active = 0;
+static uint32_t ccb_barriers = 0;	/* the barriers are mapped once, and resized per session */
+
+static const char* ccb_state_des[] =
+  {
+    "MODIFIED",
+    "OWNED",
+    "EXCLUSIVE",
+    "SHARED",
+    "INVALID",
+    "LOCAL",
+  };
+
+static const char* ccb_op_des[] =
+  {
+    "LOAD",
+    "STORE",
+    "CAS",
+    "FAI",
+    "TAS",
+    "SWAP",
+  };
+
+/* the cores that a state needs: the measuring one, the owner, and the sharer */
+static const uint32_t ccb_state_cores[] =
+  {
+    2,				/* MODIFIED */
+    3,				/* OWNED */
+    2,				/* EXCLUSIVE */
+    3,				/* SHARED */
+    1,				/* INVALID */
+    1,				/* LOCAL */
+  };
+
+const char*
+ccb_state_name(const ccb_state_t state)
+{
+  return state < CCB_NUM_STATES ? ccb_state_des[state] : "?";
+}
+
+const char*
+ccb_op_name(const ccb_op_t op)
+{
+  return op < CCB_NUM_OPS ? ccb_op_des[op] : "?";
+}
+
+static int
+ccb_set_cpu(const uint32_t cpu)
+{
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  return sched_setaffinity(0, sizeof(cpu_set_t), &mask);
+}
+
+/* the op with the kernel of ccbench: the decoys of the access sequence, then line 0, timed */
+/* into pfd store 0 */
+static inline uint64_t
+ccb_op(volatile cache_line_t* cl, const ccb_op_t op, const uint32_t rep)
+{
+  switch (op)
+    {
+    case CCB_LOAD:
+      return load_0_eventually(cl, rep);
+    case CCB_STORE:
+      store_0_eventually(cl, rep);
+      return 0;
+    case CCB_CAS:
+      return cas_0_eventually(cl, rep);
+    case CCB_FAI:
+      return fai(cl, rep);
+    case CCB_TAS:
+      return tas(cl, rep);
+    case CCB_SWAP:
+      return swap(cl, rep);
+    default:
+      return 0;
+    }
+}
+
+/* one command, like a ccbench event: per repetition, cores[0] flushes line 0, the owner and */
+/* the sharer bring it into the state with the kernels of ccbench, and cores[0] times the */
+/* operation on it */
+static void
+ccb_session_run(ccb_session_t* s)
+{
+  const uint32_t n = s->num_cores;
+  volatile cache_line_t* cl = s->lines;
+  volatile uint64_t sink = 0;
+  uint32_t rep;
+  if (ID == 0)
+    {
+      test_reps = s->reps;
+      access_init();
+    }
+
+  for (rep = 0; rep < s->reps; rep++)
+    {
+      if (ID == 0)
+	{
+	  invalidate(cl, 0, rep);
+	}
+      barrier_wait(0, ID, n);
+
+      if (ID == 1)
+	{
+	  switch (s->state)
+	    {
+	    case CCB_MODIFIED:
+	    case CCB_OWNED:
+	      store_0(cl, rep);
+	      break;
+	    case CCB_EXCLUSIVE:
+	    case CCB_SHARED:
+	      sink += load_0(cl, rep);
+	      break;
+	    default:
+	      break;
+	    }
+	}
+      else if (ID == 0 && s->state == CCB_LOCAL)
+	{
+	  sink += load_0(cl, rep);
+	}
+      barrier_wait(1, ID, n);
+
+      if (ID == 2 && (s->state == CCB_OWNED || s->state == CCB_SHARED))
+	{
+	  sink += load_0(cl, rep);
+	}
+      barrier_wait(2, ID, n);
+
+      if (ID == 0)
+	{
+	  sink += ccb_op(cl, s->op, rep);
+	}
+      barrier_wait(3, ID, n);
+    }
+
+  if (ID == 0)
+    {
+      abs_deviation_t ad;
+      get_abs_deviation(pfd_store[0], s->reps, &ad);
+      s->stats.num = s->reps;
+      s->stats.avg = ad.avg;
+      s->stats.median = get_median(pfd_store[0], s->reps);
+      s->stats.std_dev = ad.std_dev;
+      s->stats.abs_dev = ad.abs_dev;
+      s->stats.min = ad.min_val;
+      s->stats.max = ad.max_val;
+    }
+}
+
+static void*
+ccb_worker(void* arg)
+{
+  ccb_worker_t* w = (ccb_worker_t*) arg;
+  ccb_session_t* s = w->session;
+  ID = w->id;
+
+  if (ccb_set_cpu(w->core) != 0)
+    {
+      FAI_U32(&s->failed);
+      return NULL;
+    }
+  PFDINIT(s->max_reps);
+  seeds = seed_rand(CCB_SEED, ID + 1);
+  FAI_U32(&s->ready);
+
+  uint32_t seq = 0;
+  while (1)
+    {
+      while (s->seq == seq)
+	{
+	  usleep(CCB_POLL_US);
+	}
+      seq = s->seq;
+      if (s->quit)
+	{
+	  break;
+	}
+
+      ccb_session_run(s);
+      if (ID == 0)
+	{
+	  s->done = seq;
+	}
+    }
+  PFDTERM();
+  free(access_seq);
+  free(seeds);
+  return NULL;
+}
+
+static void
+ccb_session_free(ccb_session_t* s)
+{
+  free(s->workers);
+  free(s->lines);
+  free(s);
+  ccb_active = 0;
+}
+
+ccb_session_t*
+ccb_session_create(const uint32_t* cores, const uint32_t num_cores, const uint32_t max_reps)
+{
+  if (cores == NULL || num_cores == 0 || max_reps == 0)
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+  if (CAS_U32(&ccb_active, 0, 1) != 0)
+    {
+      errno = EBUSY;
+      return NULL;
+    }
+
+  ccb_session_t* s = (ccb_session_t*) calloc(1, sizeof(ccb_session_t));
+  if (s == NULL)
+    {
+      ccb_active = 0;
+      errno = ENOMEM;
+      return NULL;
+    }
+  s->num_cores = num_cores;
+  s->max_reps = max_reps;
+  s->workers = (ccb_worker_t*) calloc(num_cores, sizeof(ccb_worker_t));
+  if (s->workers == NULL || posix_memalign((void**) &s->lines, sizeof(cache_line_t),
+					   CCB_STRIDE * sizeof(cache_line_t)) != 0)
+    {
+      s->lines = NULL;
+      ccb_session_free(s);
+      errno = ENOMEM;
+      return NULL;
+    }
+  memset(s->lines, 0, CCB_STRIDE * sizeof(cache_line_t));
+  kernels_select();
+  if (!ccb_barriers)
+    {
+      barriers_init(num_cores, 1, 1);
+      ccb_barriers = 1;
+    }
+  else
+    {
+      barriers_resize(0, num_cores);
+    }
+
+  uint32_t i;
+  for (i = 0; i < num_cores; i++)
+    {
+      ccb_worker_t* w = s->workers + i;
+      w->session = s;
+      w->id = i;
+      w->core = cores[i];
+      int err = pthread_create(&w->thread, NULL, ccb_worker, w);
+      if (err != 0)
+	{
+	  /* the ones already started wait for a command: tell them to quit */
+	  s->quit = 1;
+	  s->seq++;
+	  while (i-- > 0)
+	    {
+	      pthread_join(s->workers[i].thread, NULL);
+	    }
+	  ccb_session_free(s);
+	  errno = err;
+	  return NULL;
+	}
+    }
+
+  while (s->ready + s->failed < num_cores)
+    {
+      usleep(CCB_POLL_US);
+    }
+  if (s->failed)
+    {
+      ccb_session_destroy(s);
+      errno = EINVAL;
+      return NULL;
+    }
+  return s;
+}
+
+int
+ccb_run(ccb_session_t* s, const ccb_state_t state, const ccb_op_t op, const uint32_t reps,
+	ccb_stats_t* stats)
+{
+  if (s == NULL || state >= CCB_NUM_STATES || op >= CCB_NUM_OPS || reps == 0 || reps > s->max_reps
+      || ccb_state_cores[state] > s->num_cores)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  s->state = state;
+  s->op = op;
+  s->reps = reps;
+  _mm_mfence();
+  uint32_t seq = s->seq + 1;
+  s->seq = seq;
+  while (s->done != seq)
+    {
+      usleep(CCB_POLL_US);
+    }
+
+  if (stats != NULL)
+    {
+      *stats = s->stats;
+    }
+  return 0;
+}
+
+void
+ccb_session_destroy(ccb_session_t* s)
+{
+  if (s == NULL)
+    {
+      return;
+    }
+
+  s->quit = 1;
+  _mm_mfence();
+  s->seq++;
+  uint32_t i;
+  for (i = 0; i < s->num_cores; i++)
+    {
+      pthread_join(s->workers[i].thread, NULL);
+    }
+  ccb_session_free(s);
+}
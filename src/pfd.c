@@ -31,9 +31,11 @@
 #include <math.h>
 #include "atomic_ops.h"
 
-volatile ticks** pfd_store;
-volatile ticks* _pfd_s;
-volatile ticks pfd_correction;
+__thread volatile ticks** pfd_store;
+__thread volatile ticks* _pfd_s;
+__thread volatile ticks pfd_correction;
+double pfd_correction_fallback = 0;
+int pfd_spin_up = 1;
 
 void 
 pfd_store_init(uint32_t num_entries)
@@ -45,8 +47,11 @@ pfd_store_init(uint32_t num_entries)
   volatile uint32_t i;
   for (i = 0; i < PFD_NUM_STORES; i++)
     {
-      pfd_store[i] = (ticks*) malloc(num_entries * sizeof(ticks));
-      assert(pfd_store[i] != NULL);
+      /* page aligned, so that the stores can be bound to a memory node */
+      void* mem = NULL;
+      int r = posix_memalign(&mem, PFD_STORE_ALIGN, num_entries * sizeof(ticks));
+      assert(r == 0 && mem != NULL);
+      pfd_store[i] = (ticks*) mem;
       PREFETCHW((void*) &pfd_store[i][0]);
     }
 
@@ -54,24 +59,21 @@ pfd_store_init(uint32_t num_entries)
   uint32_t print_warning = 0;
 
 
-#if defined(XEON) || defined(OPTERON2) || defined(XEON2) || defined(DEFAULT)
   /* enforcing max freq if freq scaling is enabled */
   volatile uint64_t speed;
-  for (speed = 0; speed < 20e7; speed++)
+  for (speed = 0; pfd_spin_up && speed < 20e7; speed++)
     {
       asm volatile ("");
     }
-#endif	/* XEON */
 
   pfd_correction = 0;
 
 #define PFD_CORRECTION_CONF 3
+  uint64_t v = 0;
  retry:
   for (i = 0; i < num_entries; i++)
     {
-      PFDI(0);
-      asm volatile ("");
-      PFDO(0, i);
+      PFDT(0, i, "empty", PFD_ASM_EMPTY, asm volatile (""), v, NULL, 0);
     }
 
   abs_deviation_t ad;
@@ -92,17 +94,14 @@ pfd_store_init(uint32_t num_entries)
       else
 	{
 	  printf("* warning: setting pfd correction manually\n");
-#if defined(OPTERON)
-	  ad.avg = 64;
-#elif defined(OPTERON2)
-	  ad.avg = 68;
-#elif defined(XEON) || defined(XEON2)
-	  ad.avg = 20;
-#elif defined(NIAGARA)
-	  ad.avg = 76;
-#else
-	  printf("* warning: no default value for pfd correction is provided (fix in src/pfd.c)\n");
-#endif
+	  if (pfd_correction_fallback > 0)
+	    {
+	      ad.avg = pfd_correction_fallback;
+	    }
+	  else
+	    {
+	      printf("* warning: no default value for pfd correction is known for this processor\n");
+	    }
 	}
     }
 
@@ -112,6 +111,21 @@ pfd_store_init(uint32_t num_entries)
   printf("* set pfd correction: %llu (std deviation: %.1f%%)\n", (long long unsigned int) pfd_correction, std_pp);
 }
 
+/* frees the stores of the calling process (thread) */
+void
+pfd_store_term()
+{
+  uint32_t i;
+  for (i = 0; pfd_store != NULL && i < PFD_NUM_STORES; i++)
+    {
+      free((void*) pfd_store[i]);
+    }
+  free((void*) pfd_store);
+  free((void*) _pfd_s);
+  pfd_store = NULL;
+  _pfd_s = NULL;
+}
+
 static inline 
 double absd(double x)
 {
@@ -162,6 +176,40 @@ print_abs_deviation(const abs_deviation_t* abs_dev)
 	abs_dev->num_dev_rst, vrest, abs_dev->avg_rst, abs_dev->abs_dev_rst, abs_dev->std_dev_rst, std_rspp);
 }
 
+static int
+ticks_cmp(const void* a, const void* b)
+{
+  ticks ta = *(const ticks*) a;
+  ticks tb = *(const ticks*) b;
+  return (ta > tb) - (ta < tb);
+}
+
+double
+get_median(volatile ticks* vals, const size_t num_vals)
+{
+  if (num_vals == 0)
+    {
+      return 0;
+    }
+
+  ticks* sorted = (ticks*) malloc(num_vals * sizeof(ticks));
+  assert(sorted != NULL);
+  size_t i;
+  for (i = 0; i < num_vals; i++)
+    {
+      sorted[i] = vals[i];
+    }
+  qsort(sorted, num_vals, sizeof(ticks), ticks_cmp);
+
+  double median = sorted[num_vals / 2];
+  if ((num_vals & 0x1) == 0)
+    {
+      median = (sorted[num_vals / 2 - 1] + sorted[num_vals / 2]) / 2.0;
+    }
+  free(sorted);
+  return median;
+}
+
 #define PFD_VAL_UP_LIMIT 1500	/* do not consider values higher than this value */
 
 void
@@ -0,0 +1,730 @@
+/*
+ *   File: topology.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: discovery of the processor topology (sysfs) and of the latency domains
+ *   topology.c is part of ccbench
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+
+#if defined(PLATFORM_NUMA)
+#  include <numa.h>
+#  include <numaif.h>
+#elif defined(__linux__)
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#  define MPOL_PREFERRED 1
+#  define MPOL_BIND      2
+#  define MPOL_MF_STRICT (1 << 0)
+#  define MPOL_MF_MOVE   (1 << 1)
+#endif
+
+const char* topo_class_des[] =
+  {
+    "same core (SMT)",
+    "same L2",
+    "same LLC",
+    "same socket",
+    "remote socket",
+  };
+
+static const char topo_class_code[] = "T2LSR";
+
+static topo_cpu_t* topo_cpus = NULL;
+static uint32_t topo_cpus_num = 0;
+static int32_t* topo_idx = NULL;	/* cpu id -> index in topo_cpus */
+static uint32_t topo_idx_num = 0;
+
+typedef struct topo_domain
+{
+  double min;
+  double max;
+  uint32_t num_pairs;
+} topo_domain_t;
+
+static uint32_t topo_nodes_num = 0;	/* max node id + 1 */
+static uint8_t* topo_nodes = NULL;	/* which node ids exist */
+
+static int32_t* topo_domains = NULL;	/* topo_cpus_num x topo_cpus_num */
+static topo_domain_t* topo_domain_info = NULL;
+static uint32_t topo_domains_num = 0;
+
+/* a cpu list like "0-3,8,10-11" (the format of sysfs) into cpus. Returns the number of cpus, */
+/* 0 if the list is empty or is not one: anything left over, a range that goes down, or a */
+/* cpu that does not fit in a cpu_set_t */
+uint32_t
+parse_cpu_list(const char* list, uint32_t** cpus)
+{
+  uint32_t size = 64, n = 0;
+  *cpus = (uint32_t*) malloc(size * sizeof(uint32_t));
+  assert(*cpus != NULL);
+
+  const char* p = list;
+  while (*p != '\0')
+    {
+      while (*p == ',' || isspace((unsigned char) *p))
+	{
+	  p++;
+	}
+      if (*p == '\0')
+	{
+	  break;
+	}
+      if (!isdigit((unsigned char) *p))
+	{
+	  return 0;
+	}
+
+      char* end;
+      unsigned long from = strtoul(p, &end, 10);
+      unsigned long to = from;
+      p = end;
+      if (*p == '-')
+	{
+	  if (!isdigit((unsigned char) p[1]))
+	    {
+	      return 0;
+	    }
+	  to = strtoul(p + 1, &end, 10);
+	  p = end;
+	}
+      if (to < from || to >= CPU_SETSIZE)
+	{
+	  return 0;
+	}
+      if (*p != '\0' && *p != ',' && !isspace((unsigned char) *p))
+	{
+	  return 0;
+	}
+
+      uint32_t c;
+      for (c = from; c <= to; c++)
+	{
+	  if (n == size)
+	    {
+	      size *= 2;
+	      *cpus = (uint32_t*) realloc(*cpus, size * sizeof(uint32_t));
+	      assert(*cpus != NULL);
+	    }
+	  (*cpus)[n++] = c;
+	}
+    }
+  return n;
+}
+
+static int
+sysfs_read(const char* path, char* buf, const size_t len)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    {
+      return 0;
+    }
+  char* r = fgets(buf, len, f);
+  fclose(f);
+  return (r != NULL);
+}
+
+static int32_t
+sysfs_read_int(const char* path, const int32_t def)
+{
+  char buf[64];
+  if (!sysfs_read(path, buf, sizeof(buf)))
+    {
+      return def;
+    }
+  return atoi(buf);
+}
+
+/* returns the first cpu of a cpu list file (e.g., thread_siblings_list), or def */
+static int32_t
+sysfs_read_first_cpu(const char* path, const int32_t def)
+{
+  char buf[4096];
+  if (!sysfs_read(path, buf, sizeof(buf)) || !isdigit((unsigned char) buf[0]))
+    {
+      return def;
+    }
+  return atoi(buf);
+}
+
+static void
+topo_read_caches(topo_cpu_t* tc)
+{
+  char path[256];
+  int32_t llc_lvl = 0;
+  uint32_t idx;
+  for (idx = 0; ; idx++)
+    {
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/cache/index%u/level", tc->cpu, idx);
+      int32_t lvl = sysfs_read_int(path, -1);
+      if (lvl < 0)
+	{
+	  break;
+	}
+
+      char type[32];
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/cache/index%u/type", tc->cpu, idx);
+      if (sysfs_read(path, type, sizeof(type)) && strncmp(type, "Instruction", 11) == 0)
+	{
+	  continue;
+	}
+
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/cache/index%u/shared_cpu_list", tc->cpu, idx);
+      int32_t first = sysfs_read_first_cpu(path, tc->cpu);
+      if (lvl == 2)
+	{
+	  tc->l2_id = first;
+	}
+      if (lvl >= llc_lvl)
+	{
+	  llc_lvl = lvl;
+	  tc->llc_id = first;
+	}
+    }
+}
+
+/* reads the cpulist of every NUMA node. Without sysfs nodes, everything is on node 0 */
+static void
+topo_read_nodes()
+{
+  uint32_t i;
+  topo_nodes_num = 0;
+  DIR* dir = opendir(TOPO_SYSFS_NODE);
+  if (dir != NULL)
+    {
+      struct dirent* de;
+      while ((de = readdir(dir)) != NULL)
+	{
+	  uint32_t node;
+	  if (sscanf(de->d_name, "node%u", &node) != 1)
+	    {
+	      continue;
+	    }
+	  if (node + 1 > topo_nodes_num)
+	    {
+	      topo_nodes = (uint8_t*) realloc(topo_nodes, node + 1);
+	      assert(topo_nodes != NULL);
+	      memset(topo_nodes + topo_nodes_num, 0, node + 1 - topo_nodes_num);
+	      topo_nodes_num = node + 1;
+	    }
+	  topo_nodes[node] = 2;	/* temporary mark: the cpulist is not read yet */
+	}
+      closedir(dir);
+    }
+
+  if (topo_nodes_num == 0)
+    {
+      topo_nodes_num = 1;
+      topo_nodes = (uint8_t*) realloc(topo_nodes, 1);
+      topo_nodes[0] = 1;
+      for (i = 0; i < topo_cpus_num; i++)
+	{
+	  topo_cpus[i].node = 0;
+	}
+      return;
+    }
+
+  uint32_t node;
+  for (node = 0; node < topo_nodes_num; node++)
+    {
+      if (topo_nodes[node] != 2)
+	{
+	  topo_nodes[node] = 0;
+	  continue;
+	}
+      topo_nodes[node] = 1;
+
+      char path[256], buf[4096];
+      sprintf(path, TOPO_SYSFS_NODE "/node%u/cpulist", node);
+      if (!sysfs_read(path, buf, sizeof(buf)))
+	{
+	  continue;
+	}
+      uint32_t* ncpus;
+      uint32_t n = parse_cpu_list(buf, &ncpus);
+      for (i = 0; i < n; i++)
+	{
+	  if (ncpus[i] < topo_idx_num && topo_idx[ncpus[i]] >= 0)
+	    {
+	      topo_cpus[topo_idx[ncpus[i]]].node = node;
+	    }
+	}
+      free(ncpus);
+    }
+}
+
+int
+topo_init(const uint32_t* cpus, const uint32_t num_cpus)
+{
+  topo_cpus_num = num_cpus;
+  topo_cpus = (topo_cpu_t*) calloc(num_cpus, sizeof(topo_cpu_t));
+  assert(topo_cpus != NULL);
+
+  topo_idx_num = 0;
+  uint32_t i;
+  for (i = 0; i < num_cpus; i++)
+    {
+      if (cpus[i] + 1 > topo_idx_num)
+	{
+	  topo_idx_num = cpus[i] + 1;
+	}
+    }
+  topo_idx = (int32_t*) malloc(topo_idx_num * sizeof(int32_t));
+  assert(topo_idx != NULL);
+  memset(topo_idx, 0xFF, topo_idx_num * sizeof(int32_t));
+
+  int found = 1;
+  for (i = 0; i < num_cpus; i++)
+    {
+      topo_cpu_t* tc = topo_cpus + i;
+      char path[256];
+      tc->cpu = cpus[i];
+      topo_idx[tc->cpu] = i;
+
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/topology/physical_package_id", tc->cpu);
+      tc->package = sysfs_read_int(path, -1);
+      if (tc->package < 0)
+	{
+	  found = 0;
+	  tc->package = 0;
+	}
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/topology/core_id", tc->cpu);
+      tc->core_id = sysfs_read_int(path, tc->cpu);
+      sprintf(path, TOPO_SYSFS_CPU "/cpu%u/topology/thread_siblings_list", tc->cpu);
+      tc->smt_id = sysfs_read_first_cpu(path, tc->cpu);
+
+      tc->l2_id = tc->llc_id = -1;
+      tc->node = -1;
+      topo_read_caches(tc);
+    }
+  topo_read_nodes();
+
+  topo_domains = (int32_t*) malloc(num_cpus * num_cpus * sizeof(int32_t));
+  assert(topo_domains != NULL);
+  memset(topo_domains, 0xFF, num_cpus * num_cpus * sizeof(int32_t));
+
+  return found;
+}
+
+uint32_t
+topo_num_cpus()
+{
+  return topo_cpus_num;
+}
+
+const topo_cpu_t*
+topo_get(const uint32_t cpu)
+{
+  if (cpu >= topo_idx_num || topo_idx[cpu] < 0)
+    {
+      return NULL;
+    }
+  return topo_cpus + topo_idx[cpu];
+}
+
+topo_class_t
+topo_pair_class(const uint32_t c1, const uint32_t c2)
+{
+  const topo_cpu_t* t1 = topo_get(c1);
+  const topo_cpu_t* t2 = topo_get(c2);
+  if (t1 == NULL || t2 == NULL)
+    {
+      return TOPO_REMOTE_SOCKET;
+    }
+
+  if (t1->package != t2->package)
+    {
+      return TOPO_REMOTE_SOCKET;
+    }
+  if (t1->smt_id == t2->smt_id)
+    {
+      return TOPO_SAME_CORE;
+    }
+  if (t1->l2_id >= 0 && t1->l2_id == t2->l2_id)
+    {
+      return TOPO_SAME_L2;
+    }
+  if (t1->llc_id >= 0 && t1->llc_id == t2->llc_id)
+    {
+      return TOPO_SAME_LLC;
+    }
+  return TOPO_SAME_SOCKET;
+}
+
+/* finds a core c2 (not in excl) that has distance class cls from c1. Returns 0 if there is none */
+int
+topo_representative(const topo_class_t cls, const uint32_t c1, const uint32_t* excl,
+		    const uint32_t num_excl, uint32_t* c2)
+{
+  uint32_t i, e;
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      uint32_t c = topo_cpus[i].cpu;
+      if (c == c1 || topo_pair_class(c1, c) != cls)
+	{
+	  continue;
+	}
+      for (e = 0; e < num_excl && excl[e] != c; e++)
+	;
+      if (e == num_excl)
+	{
+	  *c2 = c;
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+void
+topo_print()
+{
+  printf(" ** topology (sysfs)\n");
+  printf("%6s %8s %8s %8s %8s %8s %8s\n", "cpu", "package", "core", "smt", "l2", "llc", "node");
+  uint32_t i;
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      const topo_cpu_t* tc = topo_cpus + i;
+      printf("%6u %8d %8d %8d %8d %8d %8d\n", tc->cpu, tc->package, tc->core_id, tc->smt_id,
+	     tc->l2_id, tc->llc_id, tc->node);
+    }
+
+  uint32_t j, n = 0;
+  printf("\n ** SMT siblings:");
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      const topo_cpu_t* tc = topo_cpus + i;
+      if (tc->smt_id != (int32_t) tc->cpu || !topo_representative(TOPO_SAME_CORE, tc->cpu, NULL, 0, &j))
+	{
+	  continue;
+	}
+      printf(" %u", tc->cpu);
+      for (j = 0; j < topo_cpus_num; j++)
+	{
+	  if (j != i && topo_cpus[j].smt_id == tc->smt_id)
+	    {
+	      printf(",%u", topo_cpus[j].cpu);
+	    }
+	}
+      n++;
+    }
+  printf("%s\n", n ? "" : " none");
+
+  printf("\n ** distance classes: ");
+  for (i = 0; i < TOPO_NUM_CLASSES; i++)
+    {
+      printf("%c = %s%s", topo_class_code[i], topo_class_des[i],
+	     (i < TOPO_NUM_CLASSES - 1) ? " / " : "\n");
+    }
+  printf("      ");
+  for (j = 0; j < topo_cpus_num; j++)
+    {
+      printf(" %4u", topo_cpus[j].cpu);
+    }
+  printf("\n");
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      printf("%6u", topo_cpus[i].cpu);
+      for (j = 0; j < topo_cpus_num; j++)
+	{
+	  if (i == j)
+	    {
+	      printf(" %4s", "-");
+	    }
+	  else
+	    {
+	      printf(" %4c", topo_class_code[topo_pair_class(topo_cpus[i].cpu, topo_cpus[j].cpu)]);
+	    }
+	}
+      printf("\n");
+    }
+  printf("\n");
+}
+
+int32_t
+topo_cpu_node(const uint32_t cpu)
+{
+  const topo_cpu_t* tc = topo_get(cpu);
+  if (tc == NULL)
+    {
+      return -1;
+    }
+  return tc->node;
+}
+
+uint32_t
+topo_num_nodes()
+{
+  return topo_nodes_num;
+}
+
+int
+topo_node_valid(const int32_t node)
+{
+  return (node >= 0 && node < topo_nodes_num && topo_nodes[node]);
+}
+
+/* the distance of two nodes as reported by the firmware (SLIT), -1 if unknown */
+int32_t
+topo_node_distance(const int32_t n1, const int32_t n2)
+{
+  if (!topo_node_valid(n1) || !topo_node_valid(n2))
+    {
+      return -1;
+    }
+
+  char path[256], buf[4096];
+  sprintf(path, TOPO_SYSFS_NODE "/node%d/distance", n1);
+  if (!sysfs_read(path, buf, sizeof(buf)))
+    {
+      return -1;
+    }
+
+  /* one distance per existing node, in the order of the node ids */
+  char* s = buf;
+  int32_t node;
+  for (node = 0; node < topo_nodes_num; node++)
+    {
+      if (!topo_nodes[node])
+	{
+	  continue;
+	}
+      char* e;
+      long dist = strtol(s, &e, 10);
+      if (e == s)
+	{
+	  return -1;
+	}
+      if (node == n2)
+	{
+	  return dist;
+	}
+      s = e;
+    }
+  return -1;
+}
+
+/* the memory of the calling process is preferably allocated on node */
+void
+topo_set_preferred(const int32_t node)
+{
+  if (topo_nodes_num < 2 || !topo_node_valid(node))
+    {
+      return;
+    }
+#if defined(PLATFORM_NUMA)
+  numa_set_preferred(node);
+#elif defined(__linux__)
+  unsigned long mask[(node / (8 * sizeof(unsigned long))) + 1];
+  memset(mask, 0, sizeof(mask));
+  mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+  syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, 8 * sizeof(mask) + 1);
+#endif
+}
+
+/* binds (and migrates, if already touched) the pages of [mem, mem + size) to node. mem must */
+/* be page aligned. Returns 0 on success */
+int
+topo_mem_bind(volatile void* mem, const size_t size, const int32_t node)
+{
+  if (!topo_node_valid(node))
+    {
+      return -1;
+    }
+#if defined(PLATFORM_NUMA) || defined(__linux__)
+  unsigned long mask[(node / (8 * sizeof(unsigned long))) + 1];
+  memset(mask, 0, sizeof(mask));
+  mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+#  if defined(PLATFORM_NUMA)
+  long r = mbind((void*) mem, size, MPOL_BIND, mask, 8 * sizeof(mask) + 1, MPOL_MF_STRICT | MPOL_MF_MOVE);
+#  else
+  long r = syscall(SYS_mbind, (void*) mem, size, MPOL_BIND, mask, 8 * sizeof(mask) + 1, 
+		   MPOL_MF_STRICT | MPOL_MF_MOVE);
+#  endif
+  if (r != 0)
+    {
+      printf("* warning: could not bind memory to node %d: %s\n", node, strerror(errno));
+      return -1;
+    }
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+static const double* topo_sort_lat;
+
+static int
+topo_lat_cmp(const void* a, const void* b)
+{
+  double la = topo_sort_lat[*(const uint32_t*) a];
+  double lb = topo_sort_lat[*(const uint32_t*) b];
+  return (la > lb) - (la < lb);
+}
+
+/* groups the measured pair latencies into latency domains: the sorted latencies are split */
+/* wherever two consecutive values differ by more than TOPO_CLUSTER_GAP. Domain 0 is the */
+/* fastest. Returns the number of domains */
+uint32_t
+topo_cluster(const uint32_t* c1, const uint32_t* c2, const double* lat, const uint32_t num)
+{
+  uint32_t* order = (uint32_t*) malloc(num * sizeof(uint32_t));
+  assert(order != NULL);
+  uint32_t i;
+  for (i = 0; i < num; i++)
+    {
+      order[i] = i;
+    }
+  topo_sort_lat = lat;
+  qsort(order, num, sizeof(uint32_t), topo_lat_cmp);
+
+  free(topo_domain_info);
+  topo_domain_info = (topo_domain_t*) calloc(num + 1, sizeof(topo_domain_t));
+  assert(topo_domain_info != NULL);
+  memset(topo_domains, 0xFF, topo_cpus_num * topo_cpus_num * sizeof(int32_t));
+
+  int32_t d = -1;
+  for (i = 0; i < num; i++)
+    {
+      uint32_t p = order[i];
+      if (d < 0 || lat[p] > topo_domain_info[d].max * (1 + TOPO_CLUSTER_GAP))
+	{
+	  d++;
+	  topo_domain_info[d].min = lat[p];
+	}
+      topo_domain_info[d].max = lat[p];
+      topo_domain_info[d].num_pairs++;
+
+      int32_t i1 = (c1[p] < topo_idx_num) ? topo_idx[c1[p]] : -1;
+      int32_t i2 = (c2[p] < topo_idx_num) ? topo_idx[c2[p]] : -1;
+      if (i1 >= 0 && i2 >= 0)
+	{
+	  topo_domains[i1 * topo_cpus_num + i2] = d;
+	}
+    }
+
+  free(order);
+  topo_domains_num = d + 1;
+  return topo_domains_num;
+}
+
+int32_t
+topo_pair_domain(const uint32_t c1, const uint32_t c2)
+{
+  const topo_cpu_t* t1 = topo_get(c1);
+  const topo_cpu_t* t2 = topo_get(c2);
+  if (t1 == NULL || t2 == NULL)
+    {
+      return -1;
+    }
+  return topo_domains[(t1 - topo_cpus) * topo_cpus_num + (t2 - topo_cpus)];
+}
+
+/* prints the latency domains, the label (domain:class) of every pair, and the */
+/* inconsistencies between the latency domains and the sysfs distance classes */
+void
+topo_print_domains()
+{
+  uint32_t* cnt = (uint32_t*) calloc(topo_domains_num * TOPO_NUM_CLASSES, sizeof(uint32_t));
+  assert(cnt != NULL);
+
+  uint32_t i, j, d, k;
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      for (j = 0; j < topo_cpus_num; j++)
+	{
+	  int32_t dom = topo_domains[i * topo_cpus_num + j];
+	  if (dom >= 0)
+	    {
+	      cnt[dom * TOPO_NUM_CLASSES + topo_pair_class(topo_cpus[i].cpu, topo_cpus[j].cpu)]++;
+	    }
+	}
+    }
+
+  printf(" ** latency domains: %u\n", topo_domains_num);
+  for (d = 0; d < topo_domains_num; d++)
+    {
+      printf("  domain %2u : %7.1f - %-7.1f cycles / %5u pairs /", d, topo_domain_info[d].min,
+	     topo_domain_info[d].max, topo_domain_info[d].num_pairs);
+      for (k = 0; k < TOPO_NUM_CLASSES; k++)
+	{
+	  if (cnt[d * TOPO_NUM_CLASSES + k])
+	    {
+	      printf(" %s: %u", topo_class_des[k], cnt[d * TOPO_NUM_CLASSES + k]);
+	    }
+	}
+      printf("\n");
+    }
+
+  printf("\n ** pair labels (domain:class) / rows: core1 / columns: core2\n      ");
+  for (j = 0; j < topo_cpus_num; j++)
+    {
+      printf(" %5u", topo_cpus[j].cpu);
+    }
+  printf("\n");
+  for (i = 0; i < topo_cpus_num; i++)
+    {
+      printf("%6u", topo_cpus[i].cpu);
+      for (j = 0; j < topo_cpus_num; j++)
+	{
+	  int32_t dom = topo_domains[i * topo_cpus_num + j];
+	  if (dom < 0)
+	    {
+	      printf(" %5s", "-");
+	    }
+	  else
+	    {
+	      printf(" %3d:%c", dom, topo_class_code[topo_pair_class(topo_cpus[i].cpu, topo_cpus[j].cpu)]);
+	    }
+	}
+      printf("\n");
+    }
+  printf("\n");
+
+  /* cross-check: every distance class should fall in a single domain */
+  for (k = 0; k < TOPO_NUM_CLASSES; k++)
+    {
+      uint32_t doms = 0;
+      for (d = 0; d < topo_domains_num; d++)
+	{
+	  doms += (cnt[d * TOPO_NUM_CLASSES + k] > 0);
+	}
+      if (doms > 1)
+	{
+	  printf("* warning: pairs in class '%s' fall in %u different latency domains\n",
+		 topo_class_des[k], doms);
+	}
+    }
+
+  free(cnt);
+}